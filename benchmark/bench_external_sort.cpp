@@ -0,0 +1,87 @@
+// Benchmarks of the external-memory sort.
+//
+// An external sort is usually limited by the disk, so besides the time, each
+// benchmark reports the bandwidth that it achieved, as the bytes read and
+// written by each phase per second. Merging should stream the runs at close
+// to the sequential bandwidth of the disk as long as the merge windows are
+// large enough to be read ahead, i.e. the budget is not too small for the
+// number of runs. Files are written to the working directory, or to the
+// directory given by the PARLAY_EXTERNAL_SORT_DIRECTORY environment variable.
+// Files of this size are usually served from the page cache, so measuring the
+// disk itself needs inputs much larger than RAM, or a cache drop before
+// each run.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <benchmark/benchmark.h>
+
+#include <parlay/external_sort.h>
+#include <parlay/primitives.h>
+#include <parlay/random.h>
+#include <parlay/sequence.h>
+
+using benchmark::Counter;
+
+static std::string external_sort_filename(const std::string& name) {
+  const char* directory = std::getenv("PARLAY_EXTERNAL_SORT_DIRECTORY");
+  return (directory != nullptr ? std::string(directory) + "/" : std::string()) + name;
+}
+
+template<typename T>
+static T random_record(const parlay::random& r, size_t i) {
+  if constexpr (std::is_integral_v<T>) return static_cast<T>(r.ith_rand(i));
+  else return T{r.ith_rand(2 * i), r.ith_rand(2 * i + 1)};
+}
+
+// Sort n random records of type T with a memory budget that makes the given
+// number of runs
+template<typename T>
+static void bench_external_sort(benchmark::State& state) {
+  size_t n = state.range(0);
+  size_t runs = state.range(1);
+  auto input = external_sort_filename("bench_external_sort.in");
+  auto output = external_sort_filename("bench_external_sort.out");
+  {
+    parlay::random r(0);
+    auto in = parlay::tabulate(n, [&] (size_t i) { return random_record<T>(r, i); });
+    std::ofstream out(input, std::ios::out | std::ios::binary);
+    out.write(reinterpret_cast<const char*>(in.data()), static_cast<std::streamsize>(n * sizeof(T)));
+  }
+
+  parlay::external_sort_options options;
+  options.memory_budget = 2 * n * sizeof(T) / runs;
+  parlay::external_sort_stats stats;
+  double bytes = 0, run_bytes = 0, run_seconds = 0, merge_bytes = 0, merge_seconds = 0;
+  for (auto _ : state) {
+    stats = parlay::external_sort<T>(input, output, std::less<>(), options);
+    bytes += static_cast<double>(stats.bytes_read + stats.bytes_written);
+    run_bytes += 2.0 * static_cast<double>(n * sizeof(T));
+    run_seconds += stats.run_seconds;
+    merge_bytes += static_cast<double>(stats.bytes_read + stats.bytes_written) - 2.0 * static_cast<double>(n * sizeof(T));
+    merge_seconds += stats.merge_seconds;
+  }
+
+  std::remove(input.c_str());
+  std::remove(output.c_str());
+  state.counters["runs"] = static_cast<double>(stats.num_runs);
+  state.counters["MB/s"] = Counter(bytes / 1e6, Counter::kIsRate);
+  state.counters["run_MB/s"] = run_seconds > 0 ? run_bytes / 1e6 / run_seconds : 0;
+  state.counters["merge_MB/s"] = merge_seconds > 0 ? merge_bytes / 1e6 / merge_seconds : 0;
+}
+
+// 800MB of records of 8 and 16 bytes, sorted in one run, i.e. in memory,
+// and out of core in 8 and 64 runs
+BENCHMARK_TEMPLATE(bench_external_sort, uint64_t)
+  ->Unit(benchmark::kMillisecond)->UseRealTime()
+  ->Args({100000000, 1})->Args({100000000, 8})->Args({100000000, 64});
+BENCHMARK_TEMPLATE(bench_external_sort, std::pair<uint64_t, uint64_t>)
+  ->Unit(benchmark::kMillisecond)->UseRealTime()
+  ->Args({50000000, 1})->Args({50000000, 8})->Args({50000000, 64});
@@ -0,0 +1,107 @@
+// Benchmarks of how the backing of memory affects algorithms that use it.
+//
+// Random gathers from a large sequence are dominated by TLB misses when the
+// sequence is backed by normal 4KB pages. Backing it with 2MB huge pages
+// (parlay::huge_page_allocator) should make them faster once the sequence
+// is much larger than the TLB reach, which is a few MB with normal pages.
+// The huge_MB counter reports how much of the process is backed by
+// transparent huge pages, so a run without a speedup can be told apart
+// from a system that did not provide any.
+//
+// Allocating and freeing many small objects from many threads, as when
+// building trees, moves lists of free blocks between the threads and the
+// global pool of the block allocator. The throughput should scale with the
+// number of threads as long as that exchange does not become a bottleneck.
+
+#include <cstddef>
+#include <cstdint>
+
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <parlay/alloc.h>
+#include <parlay/parallel.h>
+#include <parlay/sequence.h>
+#include <parlay/utilities.h>
+
+using benchmark::Counter;
+
+// Megabytes of anonymous memory backed by transparent huge pages, or 0 if unknown
+static double anonymous_huge_page_megabytes() {
+  std::ifstream smaps("/proc/self/smaps_rollup");
+  std::string key;
+  size_t kilobytes;
+  while (smaps >> key) {
+    if (key == "AnonHugePages:" && smaps >> kilobytes) return static_cast<double>(kilobytes) / 1024;
+  }
+  return 0;
+}
+
+// out[i] = data[random index] for every i, where data has 2^log_n elements
+template<typename Alloc>
+static void bench_random_gather(benchmark::State& state) {
+  size_t n = size_t{1} << state.range(0);
+  parlay::sequence<uint64_t, Alloc> data(n);
+  parlay::sequence<uint64_t, Alloc> indices(n);
+  parlay::sequence<uint64_t, Alloc> out(n);
+  parlay::parallel_for(0, n, [&](size_t i) {
+    data[i] = i;
+    indices[i] = parlay::hash64(i) & (n - 1);
+  });
+  state.counters["huge_MB"] = Counter(anonymous_huge_page_megabytes());
+  for (auto _ : state) {
+    parlay::parallel_for(0, n, [&](size_t i) { out[i] = data[indices[i]]; });
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+
+BENCHMARK_TEMPLATE(bench_random_gather, parlay::allocator<uint64_t>)
+  ->Unit(benchmark::kMillisecond)->UseRealTime()->DenseRange(20, 26, 3);
+BENCHMARK_TEMPLATE(bench_random_gather, parlay::huge_page_allocator<uint64_t>)
+  ->Unit(benchmark::kMillisecond)->UseRealTime()->DenseRange(20, 26, 3);
+
+// A node of a tree, as allocated by tree building algorithms
+struct bench_node {
+  bench_node* children[4];
+  uint64_t key;
+  uint64_t value;
+};
+
+// Every benchmark thread allocates a batch of nodes and frees them again,
+// which overflows its local list into the global pool and takes lists back
+static void bench_type_allocator_threads(benchmark::State& state) {
+  using node_allocator = parlay::type_allocator<bench_node>;
+  constexpr size_t batch = 100000;
+  std::vector<bench_node*> nodes(batch);
+  for (auto _ : state) {
+    for (size_t i = 0; i < batch; i++) nodes[i] = node_allocator::alloc();
+    for (size_t i = 0; i < batch; i++) node_allocator::free(nodes[i]);
+    benchmark::DoNotOptimize(nodes.data());
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * batch));
+}
+
+// Nodes allocated in parallel and freed in parallel in a different order,
+// so that most nodes are freed by a different worker than allocated them.
+// The order is a permutation since the stride is a prime that does not divide n.
+static void bench_type_allocator_parallel(benchmark::State& state) {
+  using node_allocator = parlay::type_allocator<bench_node>;
+  size_t n = state.range(0);
+  parlay::sequence<bench_node*> nodes(n);
+  for (auto _ : state) {
+    parlay::parallel_for(0, n, [&](size_t i) { nodes[i] = node_allocator::alloc(); });
+    parlay::parallel_for(0, n, [&](size_t i) { node_allocator::free(nodes[(i * 1000003) % n]); });
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+
+BENCHMARK(bench_type_allocator_threads)
+  ->Unit(benchmark::kMillisecond)->UseRealTime()
+  ->ThreadRange(1, static_cast<int>(std::thread::hardware_concurrency()));
+BENCHMARK(bench_type_allocator_parallel)
+  ->Unit(benchmark::kMillisecond)->UseRealTime()->Arg(10000000);
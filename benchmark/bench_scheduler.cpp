@@ -0,0 +1,114 @@
+// Benchmarks for the scheduler itself.
+//
+// The latency benchmarks are for services that issue many short parallel
+// requests, which care about how quickly idle workers join in when a
+// request arrives, and in particular about the tail of that latency. Each
+// of them takes an idle time in microseconds as its argument, which the
+// workers spend without work before every sample, so that they have gone
+// to sleep if the idle time exceeds the steal timeout
+// (PARLAY_ELASTIC_STEAL_TIMEOUT). Percentiles of the samples are reported
+// as counters, in microseconds.
+
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <parlay/parallel.h>
+
+using benchmark::Counter;
+using clock_type = std::chrono::steady_clock;
+
+static double microseconds_since(clock_type::time_point start) {
+  return std::chrono::duration<double, std::micro>(clock_type::now() - start).count();
+}
+
+static void report_percentiles(benchmark::State& state, std::vector<double>& samples) {
+  if (samples.empty()) return;
+  std::sort(samples.begin(), samples.end());
+  auto percentile = [&](double p) { return samples[static_cast<size_t>(p * static_cast<double>(samples.size() - 1))]; };
+  state.counters["p50_us"] = Counter(percentile(0.50));
+  state.counters["p90_us"] = Counter(percentile(0.90));
+  state.counters["p99_us"] = Counter(percentile(0.99));
+  state.counters["max_us"] = Counter(samples.back());
+}
+
+// Time from spawning a job until another worker has stolen it and started
+// running it, while the spawning worker waits for that to happen
+static void bench_wake_to_first_steal(benchmark::State& state) {
+  if (parlay::num_workers() < 2) {
+    state.SkipWithError("requires at least two workers");
+    return;
+  }
+  auto idle = std::chrono::microseconds(state.range(0));
+  std::vector<double> samples;
+  for (auto _ : state) {
+    std::this_thread::sleep_for(idle);
+    std::atomic<bool> stolen{false};
+    double latency = 0;
+    auto start = clock_type::now();
+    parlay::par_do(
+      [&]() { while (!stolen.load(std::memory_order_acquire)) std::this_thread::yield(); },
+      [&]() {
+        latency = microseconds_since(start);
+        stolen.store(true, std::memory_order_release);
+      });
+    state.SetIterationTime(latency / 1e6);
+    samples.push_back(latency);
+  }
+  report_percentiles(state, samples);
+}
+
+// End-to-end time of a small parallel loop, such as one request
+static void bench_small_request(benchmark::State& state) {
+  auto idle = std::chrono::microseconds(state.range(0));
+  std::vector<double> samples;
+  std::vector<double> a(10000);
+  for (auto _ : state) {
+    std::this_thread::sleep_for(idle);
+    auto start = clock_type::now();
+    parlay::parallel_for(0, a.size(), [&](size_t i) { a[i] = a[i] * 0.5 + static_cast<double>(i); }, 64);
+    double latency = microseconds_since(start);
+    state.SetIterationTime(latency / 1e6);
+    samples.push_back(latency);
+  }
+  benchmark::DoNotOptimize(a.data());
+  report_percentiles(state, samples);
+}
+
+// Throughput of a fine-grained loop whose iterations differ in cost by
+// orders of magnitude, so that the work has to be rebalanced by many steals.
+// Build bench_scheduler_growable_deque to compare the growable deque with
+// batch steals (PARLAY_GROWABLE_DEQUE) against the default deque.
+static void bench_irregular_parallel_for(benchmark::State& state) {
+  size_t n = state.range(0);
+  std::vector<uint64_t> a(n);
+  auto cost = [](size_t i) -> size_t {
+    uint64_t h = (i + 1) * 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 29;
+    // Most iterations are cheap, one in 64 is 256 times as expensive
+    return (h % 64 == 0) ? 4096 : 16;
+  };
+  for (auto _ : state) {
+    parlay::parallel_for(0, n, [&](size_t i) {
+      uint64_t x = i;
+      for (size_t j = 0; j < cost(i); j++) x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+      a[i] = x;
+    }, 1);
+    benchmark::DoNotOptimize(a.data());
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+
+// Idle times: none, shorter than the steal timeout, and long enough to sleep
+BENCHMARK(bench_wake_to_first_steal)->UseManualTime()->Unit(benchmark::kMicrosecond)
+  ->Iterations(200)->Arg(0)->Arg(1000)->Arg(20000);
+BENCHMARK(bench_small_request)->UseManualTime()->Unit(benchmark::kMicrosecond)
+  ->Iterations(200)->Arg(0)->Arg(1000)->Arg(20000);
+BENCHMARK(bench_irregular_parallel_for)->Unit(benchmark::kMillisecond)->UseRealTime()
+  ->Arg(100000)->Arg(1000000);
@@ -2,6 +2,10 @@
 // The main set used to evaluate performance enhancements
 // to the library
 
+#include <cstdlib>
+
+#include <string>
+
 #include <benchmark/benchmark.h>
 
 #include <parlay/monoid.h>
@@ -9,6 +13,7 @@
 #include <parlay/primitives.h>
 #include <parlay/random.h>
 #include <parlay/io.h>
+#include <parlay/trace.h>
 
 #include "trigram_words.h"
 
@@ -49,6 +54,13 @@ using benchmark::Counter;
   state.counters["    Elements/sec"] = Counter(state.iterations()*(n), Counter::kIsRate);                                            \
   state.counters["       Bytes/sec"] = Counter(state.iterations()*(n)*(sizeof(T)), Counter::kIsRate);
 
+// Report the most bytes per element allocated at once inside the
+// parlay::memory_scope with the given tag. Only reported when the
+// library is built with PARLAY_MEMORY_ACCOUNTING.
+#define REPORT_PEAK_MEMORY(tag, n)                                                                                                   \
+  for (const auto& [tag_, stats_] : parlay::memory_accounting_report().scopes)                                                      \
+    if (tag_ == (tag)) state.counters["  Peak bytes/elem"] = Counter(static_cast<double>(stats_.peak_bytes) / (n));
+
 
 template<typename T>
 static void bench_map(benchmark::State& state) {
@@ -316,6 +328,54 @@ static void bench_integer_sort(benchmark::State& state) {
   REPORT_STATS(n, 0, 0);
 }
 
+// The stable in-place integer sort, which sorts through a temporary copy
+template<typename T>
+static void bench_stable_integer_sort_inplace(benchmark::State& state) {
+  size_t n = state.range(0);
+  parlay::random r(0);
+  size_t bits = sizeof(T)*8;
+  auto in = parlay::tabulate(n, [&] (size_t i) -> T {
+				 return r.ith_rand(i);});
+  auto out = in;
+  auto identity = [] (T a) {return a;};
+  auto tag = "stable_integer_sort_inplace " + std::to_string(sizeof(T));
+
+  while (state.KeepRunningBatch(10)) {
+    for (int i = 0; i < 10; i++) {
+      COPY_NO_TIME(out, in);
+      parlay::memory_scope scope(tag);
+      parlay::internal::integer_sort_inplace(parlay::make_slice(out), identity, bits);
+    }
+  }
+
+  REPORT_STATS(n, 0, 0);
+  REPORT_PEAK_MEMORY(tag, n);
+}
+
+// The unstable in-place integer sort, which permutes blocks in place
+template<typename T>
+static void bench_integer_sort_inplace(benchmark::State& state) {
+  size_t n = state.range(0);
+  parlay::random r(0);
+  size_t bits = sizeof(T)*8;
+  auto in = parlay::tabulate(n, [&] (size_t i) -> T {
+				 return r.ith_rand(i);});
+  auto out = in;
+  auto identity = [] (T a) {return a;};
+  auto tag = "integer_sort_inplace " + std::to_string(sizeof(T));
+
+  while (state.KeepRunningBatch(10)) {
+    for (int i = 0; i < 10; i++) {
+      COPY_NO_TIME(out, in);
+      parlay::memory_scope scope(tag);
+      parlay::internal::radix_sort_inplace(parlay::make_slice(out), identity, bits);
+    }
+  }
+
+  REPORT_STATS(n, 0, 0);
+  REPORT_PEAK_MEMORY(tag, n);
+}
+
 template<typename T>
 static void bench_sort(benchmark::State& state) {
   size_t n = state.range(0);
@@ -347,21 +407,61 @@ void bench_sort<parlay::sequence<char>>(benchmark::State& state) {
   REPORT_STATS(n, 0, 0);
 }
 
+template<typename T>
+static void bench_string_sort(benchmark::State& state) {
+  size_t n = state.range(0);
+  ngram_table words;
+  auto in = parlay::tabulate(n, [&] (size_t i) -> T {return words.word(i);});
+
+  while (state.KeepRunningBatch(10)) {
+    for (int i = 0; i < 10; i++) {
+      RUN_AND_CLEAR(parlay::string_sort(in));
+    }
+  }
+
+  REPORT_STATS(n, 0, 0);
+}
+
+// The in-place sample sort, which sorts through a temporary copy
 template<typename T>
 static void bench_sort_inplace(benchmark::State& state) {
   size_t n = state.range(0);
   parlay::random r(0);
   auto in = parlay::tabulate(n, [&] (size_t i) -> T { return r.ith_rand(i) % n; });
   auto out = in;
+  auto tag = "sort_inplace " + std::to_string(sizeof(T));
 
   while (state.KeepRunningBatch(10)) {
     for (int i = 0; i < 10; i++) {
       COPY_NO_TIME(out, in);
+      parlay::memory_scope scope(tag);
       parlay::internal::sample_sort_inplace(parlay::make_slice(out), std::less<T>());
     }
   }
 
   REPORT_STATS(n, 0, 0);
+  REPORT_PEAK_MEMORY(tag, n);
+}
+
+// The block sample sort, which permutes blocks in place
+template<typename T>
+static void bench_block_sample_sort_inplace(benchmark::State& state) {
+  size_t n = state.range(0);
+  parlay::random r(0);
+  auto in = parlay::tabulate(n, [&] (size_t i) -> T { return r.ith_rand(i) % n; });
+  auto out = in;
+  auto tag = "block_sample_sort_inplace " + std::to_string(sizeof(T));
+
+  while (state.KeepRunningBatch(10)) {
+    for (int i = 0; i < 10; i++) {
+      COPY_NO_TIME(out, in);
+      parlay::memory_scope scope(tag);
+      parlay::internal::block_sample_sort_inplace(parlay::make_slice(out), std::less<T>());
+    }
+  }
+
+  REPORT_STATS(n, 0, 0);
+  REPORT_PEAK_MEMORY(tag, n);
 }
 
 template<typename T>
@@ -652,11 +752,18 @@ BENCH(count_sort, long, 100000000/PSIZE_FACTOR, 4);
 BENCH(count_sort, long, 100000000/PSIZE_FACTOR, 8);
 BENCH(integer_sort, unsigned int, 100000000/PSIZE_FACTOR);
 BENCH(integer_sort_pair, unsigned int, 100000000/PSIZE_FACTOR);
+BENCH(stable_integer_sort_inplace, unsigned int, 100000000/PSIZE_FACTOR);
+BENCH(integer_sort_inplace, unsigned int, 100000000/PSIZE_FACTOR);
+BENCH(stable_integer_sort_inplace, unsigned long, 100000000/PSIZE_FACTOR);
+BENCH(integer_sort_inplace, unsigned long, 100000000/PSIZE_FACTOR);
 BENCH(sort, unsigned int, 100000000/PSIZE_FACTOR);
 BENCH(sort, long, 100000000/PSIZE_FACTOR);
 BENCH(sort, parlay::sequence<char>, 100000000/PSIZE_FACTOR);
+BENCH(string_sort, parlay::sequence<char>, 100000000/PSIZE_FACTOR);
 BENCH(sort_inplace, unsigned int, 100000000/PSIZE_FACTOR);
 BENCH(sort_inplace, long, 100000000/PSIZE_FACTOR);
+BENCH(block_sample_sort_inplace, unsigned int, 100000000/PSIZE_FACTOR);
+BENCH(block_sample_sort_inplace, long, 100000000/PSIZE_FACTOR);
 BENCH(merge, long, 100000000/PSIZE_FACTOR);
 BENCH(merge_sort, long, 100000000/PSIZE_FACTOR);
 BENCH(quicksort, long, 100000000/PSIZE_FACTOR);
@@ -687,3 +794,17 @@ BENCH(sort, __int128, 100000000/PSIZE_FACTOR);
 BENCH(sort_inplace, __int128, 100000000/PSIZE_FACTOR);
 BENCH(integer_sort, __int128, 100000000/PSIZE_FACTOR);
 #endif
+
+#if PARLAY_SCHEDULER_TRACE
+// When built with tracing, record the timeline of the scheduler during the
+// run and write it to the file named by PARLAY_TRACE_FILE. Only the end of
+// the run fits in the trace, so select one benchmark with --benchmark_filter.
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  const char* filename = std::getenv("PARLAY_TRACE_FILE");
+  parlay::scheduler_trace trace(size_t{1} << 20);
+  benchmark::RunSpecifiedBenchmarks();
+  trace.write_chrome_trace(filename ? filename : "bench_standard_trace.json");
+}
+#endif
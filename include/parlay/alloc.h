@@ -9,17 +9,24 @@
 #include <algorithm>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <new>
+#include <string>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
+#include "parallel.h"
 #include "type_traits.h"  // IWYU pragma: keep
 #include "utilities.h"
 
 #include "internal/block_allocator.h"
+#include "internal/memory_accounting.h"
 #include "internal/memory_size.h"
+#include "internal/memory_trimmer.h"
+#include "internal/os_memory.h"
 #include "internal/pool_allocator.h"
+#include "internal/topology.h"
 
 // IWYU pragma: no_forward_declare is_trivially_relocatable
 
@@ -72,8 +79,45 @@ inline void memory_clear() {
   return get_default_allocator().clear();
 }
 
+inline memory_trimmer& get_memory_trimmer() {
+  static memory_trimmer trimmer(get_default_allocator());
+  return trimmer;
+}
+
 }  // namespace internal
 
+// Counters of how often large allocations (256KB and up) were served by a
+// cached block instead of the system allocator, since the program started
+inline large_allocation_statistics large_allocation_stats() {
+  return internal::get_default_allocator().large_stats();
+}
+
+// Limit the total size of the freed large blocks that are kept for reuse,
+// in bytes. 0 means no limit. Blocks that are already cached are kept.
+inline void set_large_allocation_cache_limit(size_t bytes) {
+  internal::get_default_allocator().set_large_cache_limit(bytes);
+}
+
+// Return the free memory held by the pool allocator to the system: cached
+// large blocks, and buffers of small blocks that no thread holds on to.
+// Returns the number of bytes released. Safe to call while other threads
+// allocate and free memory.
+inline size_t memory_trim() {
+  return internal::get_default_allocator().trim();
+}
+
+// Trim the pool allocator in the background whenever the program has been
+// idle for a while, as given by the policy. Set an interval of 0 to stop.
+inline void set_memory_trim_policy(const memory_trim_policy& policy) {
+  internal::get_memory_trimmer().set_policy(policy);
+}
+
+// How often the pool allocator was trimmed, and how much memory that
+// returned to the system, since the program started
+inline memory_trim_statistics memory_trim_stats() {
+  return internal::get_default_allocator().trim_stats();
+}
+
 // ----------------------------------------------------------------------------
 //  Free allocation functions
 //
@@ -195,6 +239,122 @@ template <class T, class U>
 bool operator!=(const allocator<T>&, const allocator<U>&) { return false; }
 
 
+// A container allocator that backs allocations of 2MB and more with huge
+// pages where the system provides them, e.g.
+//    parlay::sequence<int, parlay::huge_page_allocator<int>> s(n);
+//
+// Large random-access workloads (hash tables, gathers, sparse matrix-vector
+// products) spend much of their time on TLB misses, which huge pages make
+// 512 times rarer. Uses pages reserved by the administrator if there are
+// any, and otherwise asks for transparent huge pages. If neither is
+// available, the memory is backed by normal pages. Smaller allocations
+// are served by parlay::allocator.
+//
+// Large blocks are mapped from and returned to the operating system on
+// every allocation, so this suits long-lived sequences rather than
+// temporaries. To back all large blocks by huge pages, compile with
+// PARLAY_HUGE_PAGES instead.
+template <typename T>
+struct huge_page_allocator {
+  using value_type = T;
+
+  T* allocate(size_t n) {
+    size_t bytes = n * sizeof(T);
+    if (bytes < internal::huge_page_size) return allocator<T>{}.allocate(n);
+    void* buffer = internal::os_allocate(bytes, true);
+    if (buffer == nullptr) throw std::bad_alloc();
+    return static_cast<T*>(buffer);
+  }
+
+  void deallocate(T* ptr, size_t n) {
+    size_t bytes = n * sizeof(T);
+    if (bytes < internal::huge_page_size) allocator<T>{}.deallocate(ptr, n);
+    else internal::os_deallocate(static_cast<void*>(ptr), bytes, true);
+  }
+
+  constexpr huge_page_allocator() = default;
+  template <class U> /* implicit */ constexpr huge_page_allocator(const huge_page_allocator<U>&) noexcept { }
+};
+
+template <class T, class U>
+bool operator==(const huge_page_allocator<T>&, const huge_page_allocator<U>&) { return true; }
+template <class T, class U>
+bool operator!=(const huge_page_allocator<T>&, const huge_page_allocator<U>&) { return false; }
+
+
+// How numa_allocator places the pages of large allocations on NUMA nodes
+enum class numa_policy {
+  // Pages are assigned to the nodes round-robin, as with numactl -i all,
+  // so that memory bandwidth is spread evenly over all nodes
+  interleave,
+  // Pages are touched in parallel when they are allocated, in one
+  // contiguous block per worker, as parallel loops over the elements split
+  // them into contiguous blocks, so that pages tend to be placed on the
+  // nodes of the workers that later process them
+  first_touch,
+};
+
+// A container allocator that controls the NUMA placement of allocations of
+// 2MB and more, e.g.
+//    parlay::sequence<double, parlay::numa_allocator<double>> a(n);
+//
+// Without it, the pages of a sequence go to the node of whichever worker
+// first touches them, which for sequence::uninitialized(n) is up to the
+// code that initializes it. If interleaving is not supported (e.g., not on
+// Linux, or the process may not set memory policies), the allocator falls
+// back to parallel first touch. Smaller allocations are served by
+// parlay::allocator.
+template <typename T, numa_policy Policy = numa_policy::interleave>
+struct numa_allocator {
+  using value_type = T;
+
+  template <typename U>
+  struct rebind { using other = numa_allocator<U, Policy>; };
+
+  T* allocate(size_t n) {
+    size_t bytes = n * sizeof(T);
+    if (bytes < internal::huge_page_size) return allocator<T>{}.allocate(n);
+    void* buffer = internal::os_allocate(bytes, false);
+    if (buffer == nullptr) throw std::bad_alloc();
+    if (Policy != numa_policy::interleave ||
+        !internal::interleave_pages(buffer, bytes, internal::get_numa_topology().node_ids)) {
+      first_touch(buffer, bytes);
+    }
+    return static_cast<T*>(buffer);
+  }
+
+  void deallocate(T* ptr, size_t n) {
+    size_t bytes = n * sizeof(T);
+    if (bytes < internal::huge_page_size) allocator<T>{}.deallocate(ptr, n);
+    else internal::os_deallocate(static_cast<void*>(ptr), bytes, false);
+  }
+
+  constexpr numa_allocator() = default;
+  template <class U> /* implicit */ constexpr numa_allocator(const numa_allocator<U, Policy>&) noexcept { }
+
+ private:
+  // Write one byte of each page, with the pages split into one contiguous
+  // block per worker. Touching single pages in parallel would scatter them
+  // over the workers at random.
+  static void first_touch(void* buffer, size_t bytes) {
+    size_t page_size = internal::os_page_size();
+    size_t num_pages = (bytes + page_size - 1) / page_size;
+    size_t num_blocks = (std::min)(num_pages, num_workers());
+    auto pages = static_cast<volatile char*>(buffer);
+    parallel_for(0, num_blocks, [&](size_t b) {
+      for (size_t i = b * num_pages / num_blocks; i < (b + 1) * num_pages / num_blocks; i++) {
+        pages[i * page_size] = 0;
+      }
+    }, 1);
+  }
+};
+
+template <class T, class U, numa_policy P>
+bool operator==(const numa_allocator<T, P>&, const numa_allocator<U, P>&) { return true; }
+template <class T, class U, numa_policy P>
+bool operator!=(const numa_allocator<T, P>&, const numa_allocator<U, P>&) { return false; }
+
+
 // ----------------------------------------------------------------------------
 // Static allocator for single items of a given type, e.g.
 //   using long_allocator = type_allocator<long>;
@@ -243,6 +403,9 @@ public:
   static T* alloc() {
     void* buffer = get_allocator().alloc();
     assert(reinterpret_cast<uintptr_t>(buffer) % alignof(T) == 0);
+#if PARLAY_MEMORY_ACCOUNTING
+    internal::get_type_memory_counters<T>().on_allocate(0, get_allocator().get_block_size());
+#endif
     return static_cast<T*>(buffer);
   }
 
@@ -250,6 +413,9 @@ public:
   static void free(T* ptr) {
     assert(ptr != nullptr);
     assert(reinterpret_cast<uintptr_t>(ptr) % alignof(T) == 0);
+#if PARLAY_MEMORY_ACCOUNTING
+    internal::get_type_memory_counters<T>().on_deallocate(0, get_allocator().get_block_size());
+#endif
     get_allocator().free(static_cast<void*>(ptr));
   }
 
@@ -283,8 +449,98 @@ public:
   static size_t num_used_blocks() { return get_allocator().num_used_blocks(); }
   static size_t num_used_bytes() { return num_used_blocks() * block_size(); }
   static void print_stats() { get_allocator().print_stats(); }
+
+  // Return the memory of free objects to the system (see block_allocator::trim)
+  static size_t trim() { return get_allocator().trim(); }
+};
+
+// ----------------------------------------------------------------------------
+//                            Memory accounting
+//
+// With PARLAY_MEMORY_ACCOUNTING, the allocators count the bytes that are
+// currently allocated, and the most that ever were, by size class of the pool
+// allocator and by type_allocator<T>. A memory_scope additionally attributes
+// the allocations made while it is active to a tag, e.g.
+//    { parlay::memory_scope scope("sort"); parlay::sort_inplace(a); }
+//    std::cout << parlay::memory_accounting_report();
+// ----------------------------------------------------------------------------
+
+// Attributes the memory allocated from the pool allocator between its
+// construction and destruction to the given tag. The totals of scopes with
+// the same tag are added up. Scopes measure the allocations of the whole
+// program while they are active, not only those of the thread that created
+// them, so they are meant to bracket the phases of a program. Nested scopes
+// are fine; overlapping ones that are not nested give approximate peaks.
+//
+// Does nothing unless PARLAY_MEMORY_ACCOUNTING is true.
+class memory_scope {
+ public:
+  explicit memory_scope([[maybe_unused]] std::string tag_) {
+#if PARLAY_MEMORY_ACCOUNTING
+    tag = std::move(tag_);
+    auto& counters = internal::get_default_allocator().total_memory_counters();
+    start_bytes = counters.current(0);
+    start_allocated = counters.snapshot(0).allocated_bytes;
+    outer_peak = counters.begin_window(0);
+#endif
+  }
+
+  memory_scope(const memory_scope&) = delete;
+  memory_scope& operator=(const memory_scope&) = delete;
+
+  ~memory_scope() {
+#if PARLAY_MEMORY_ACCOUNTING
+    auto& counters = internal::get_default_allocator().total_memory_counters();
+    long long peak = counters.end_window(0, outer_peak);
+    long long end_bytes = counters.current(0);
+    size_t allocated = counters.snapshot(0).allocated_bytes - start_allocated;
+    auto& registry = internal::get_memory_accounting_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto& stats = registry.scopes[tag];
+    stats.entries++;
+    stats.allocated_bytes += allocated;
+    stats.retained_bytes += end_bytes - start_bytes;
+    stats.peak_bytes = (std::max)(stats.peak_bytes, static_cast<size_t>((std::max)(peak - start_bytes, 0LL)));
+#endif
+  }
+
+#if PARLAY_MEMORY_ACCOUNTING
+ private:
+  std::string tag;
+  long long start_bytes;
+  size_t start_allocated;
+  long long outer_peak;
+#endif
 };
 
+// The memory currently allocated and the peak, by size class, by
+// type_allocator<T> and by tag of memory_scope. Empty unless
+// PARLAY_MEMORY_ACCOUNTING is true.
+inline memory_report memory_accounting_report() {
+  memory_report report;
+#if PARLAY_MEMORY_ACCOUNTING
+  internal::get_default_allocator().memory_accounting(report);
+  auto& registry = internal::get_memory_accounting_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (const auto& [name, counters] : registry.types) {
+    report.types.emplace_back(name, counters->snapshot(0));
+  }
+  report.scopes.assign(registry.scopes.begin(), registry.scopes.end());
+#endif
+  return report;
+}
+
+// Start the peaks of the size classes and types over from the current
+// levels, and forget the totals of the memory scopes
+inline void reset_memory_peaks() {
+#if PARLAY_MEMORY_ACCOUNTING
+  internal::get_default_allocator().reset_memory_peaks();
+  auto& registry = internal::get_memory_accounting_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (auto& [name, counters] : registry.types) counters->reset_peaks();
+  registry.scopes.clear();
+#endif
+}
 
 }  // namespace parlay
 
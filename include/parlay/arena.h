@@ -0,0 +1,200 @@
+#ifndef PARLAY_ARENA_H_
+#define PARLAY_ARENA_H_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "alloc.h"
+#include "parallel.h"
+#include "sequence.h"
+
+#include "internal/current_arena.h"
+
+// ----------------------------------------------------------------------------
+// Arenas for temporaries that all die at the end of a phase of an algorithm.
+// While a parlay::arena is alive, memory allocated through
+// parlay::arena_allocator by the thread that created it, and by the workers
+// that run the jobs that it forks, is bump-allocated from chunks owned by
+// the arena, one chunk per worker at a time. Freeing such memory does
+// nothing. It is all released at once when the arena is destroyed, e.g.
+//
+//    for (int round = 0; round < rounds; round++) {
+//      parlay::arena phase;
+//      auto evens = parlay::filter(a, [](auto x) { return x % 2 == 0; });
+//      ...
+//    }
+//
+// Primitives allocate the temporaries that they free before returning with
+// arena_allocator, so they use the arena without affecting their results.
+// Sequences allocated with arena_allocator inside an arena scope must be
+// freed inside it, by a thread that the arena was passed to, and not used
+// after it is destroyed. Outside of any arena, arena_allocator is the
+// default sequence allocator, and adds nothing to its allocations.
+// ----------------------------------------------------------------------------
+
+namespace parlay {
+
+template <typename T>
+struct arena_allocator;
+
+class arena {
+ public:
+  static inline constexpr size_t default_chunk_size = size_t{1} << 20;
+
+  // Make this the current arena of the calling thread until it is destroyed
+  explicit arena(size_t chunk_size_ = default_chunk_size)
+      : chunk_size(chunk_size_),
+        num_slots(num_workers()),
+        slots(std::make_unique<slot[]>(num_slots)),
+        outer(std::exchange(internal::current_arena(), this)) {}
+
+  arena(const arena&) = delete;
+  arena& operator=(const arena&) = delete;
+
+  // Must be destroyed by the thread that created it
+  ~arena() {
+    assert(internal::current_arena() == this && "arenas must be destroyed in the reverse order of creation");
+    internal::current_arena() = outer;
+    size_t count = num_regions.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; i++) {
+      internal::get_default_allocator().deallocate(regions[i].begin, regions[i].end - regions[i].begin);
+    }
+  }
+
+  // Allocate n bytes aligned to align, which must be a power of two no
+  // larger than internal::pool_allocator::max_alignment
+  void* allocate(size_t n, size_t align) {
+    assert(align > 0 && (align & (align - 1)) == 0 && align <= internal::pool_allocator::max_alignment);
+    slot& s = slots[worker_id() % num_slots];
+    while (s.lock.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
+    auto next = (reinterpret_cast<uintptr_t>(s.next) + align - 1) & ~(align - 1);
+    void* result;
+    if (s.next != nullptr && next + n <= reinterpret_cast<uintptr_t>(s.end)) {
+      result = reinterpret_cast<void*>(next);
+      s.next = static_cast<std::byte*>(result) + n;
+    } else if (n > chunk_size / 4) {
+      // Large blocks get a chunk of their own, so the current one is kept
+      result = new_chunk(n);
+    } else {
+      result = new_chunk(chunk_size);
+      s.next = static_cast<std::byte*>(result) + n;
+      s.end = static_cast<std::byte*>(result) + chunk_size;
+    }
+    s.lock.clear(std::memory_order_release);
+    return result;
+  }
+
+  // Whether p points into memory that the arena has taken from the pool
+  // allocator. Safe to call concurrently with allocations.
+  [[nodiscard]] bool owns(const void* p) const {
+    auto x = static_cast<const std::byte*>(p);
+    size_t count = num_regions.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; i++) {
+      if (regions[i].begin <= x && x < regions[i].end) return true;
+    }
+    return false;
+  }
+
+  // The total size of the memory that the arena has taken from the pool
+  // allocator. Not synchronized with concurrent allocations.
+  [[nodiscard]] size_t bytes_reserved() const {
+    size_t total = 0, count = num_regions.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; i++) total += regions[i].end - regions[i].begin;
+    return total;
+  }
+
+ private:
+  template <typename T>
+  friend struct arena_allocator;
+
+  struct alignas(128) slot {
+    std::atomic_flag lock = ATOMIC_FLAG_INIT;
+    std::byte* next{nullptr};
+    std::byte* end{nullptr};
+  };
+
+  // Chunks are carved out of a few regions of doubling size, so that owns()
+  // only has to check a handful of address ranges
+  struct region {
+    std::byte* begin;
+    std::byte* end;
+  };
+
+  static inline constexpr size_t max_regions = 64;
+
+  void* new_chunk(size_t size) {
+    constexpr size_t align = internal::pool_allocator::max_alignment;
+    size = (size + align - 1) & ~(align - 1);
+    std::lock_guard<std::mutex> lock(region_mutex);
+    size_t count = num_regions.load(std::memory_order_relaxed);
+    if (count == 0 || region_next + size > regions[count - 1].end) {
+      assert(count < max_regions);
+      size_t region_size = (std::max)(size, count == 0 ? 4 * chunk_size
+                                                       : 2 * static_cast<size_t>(regions[count - 1].end - regions[count - 1].begin));
+      auto begin = static_cast<std::byte*>(internal::get_default_allocator().allocate(region_size));
+      regions[count] = region{begin, begin + region_size};
+      region_next = begin;
+      num_regions.store(count + 1, std::memory_order_release);
+    }
+    void* chunk = region_next;
+    region_next += size;
+    return chunk;
+  }
+
+  size_t chunk_size;
+  size_t num_slots;
+  std::unique_ptr<slot[]> slots;
+  std::mutex region_mutex;
+  std::byte* region_next{nullptr};
+  region regions[max_regions];
+  std::atomic<size_t> num_regions{0};
+  arena* outer;
+};
+
+// A container allocator that allocates from the current arena of the
+// calling thread, if it has one, and otherwise is the default sequence
+// allocator. Memory is given back to the default allocator unless one of
+// the arenas current on the freeing thread owns it. Arena allocations are
+// aligned to pool_allocator::max_alignment, since sequences store objects
+// of other types in their raw byte buffers.
+template <typename T>
+struct arena_allocator {
+  using value_type = T;
+
+  T* allocate(size_t n) {
+    if (arena* a = internal::current_arena(); a != nullptr && alignof(T) <= alignment) {
+      return static_cast<T*>(a->allocate(n * sizeof(T), alignment));
+    }
+    return internal::sequence_default_allocator<T>{}.allocate(n);
+  }
+
+  void deallocate(T* ptr, size_t n) {
+    for (arena* a = internal::current_arena(); a != nullptr; a = a->outer) {
+      if (a->owns(ptr)) return;
+    }
+    internal::sequence_default_allocator<T>{}.deallocate(ptr, n);
+  }
+
+  constexpr arena_allocator() = default;
+  template <class U> /* implicit */ constexpr arena_allocator(const arena_allocator<U>&) noexcept { }
+
+ private:
+  static inline constexpr size_t alignment = internal::pool_allocator::max_alignment;
+};
+
+template <class T, class U>
+bool operator==(const arena_allocator<T>&, const arena_allocator<U>&) { return true; }
+template <class T, class U>
+bool operator!=(const arena_allocator<T>&, const arena_allocator<U>&) { return false; }
+
+}  // namespace parlay
+
+#endif  // PARLAY_ARENA_H_
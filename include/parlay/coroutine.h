@@ -0,0 +1,429 @@
+#ifndef PARLAY_COROUTINE_H_
+#define PARLAY_COROUTINE_H_
+
+// ----------------------------------------------------------------------------
+// C++20 coroutines that run on Parlay's workers. A coroutine that waits for
+// I/O or a timer suspends instead of blocking, so the worker that was running
+// it is free to steal other work, and the coroutine is resumed by whichever
+// worker picks it up once the operation completes.
+//
+//    parlay::task<size_t> count_words(std::string filename) {
+//      auto text = co_await parlay::blocking([&]() {
+//        return parlay::chars_from_file(filename);
+//      });
+//      co_return parlay::count_if(text, [](char c) { return c == ' '; });
+//    }
+//
+//    parlay::parallel_for(0, files.size(), [&](size_t i) {
+//      counts[i] = parlay::sync_wait(count_words(files[i]));
+//    });
+//
+//  - task<T>:       a lazily started coroutine returning T, which can be
+//                   co_awaited by another task or run with sync_wait
+//  - blocking(f):   run the blocking callable f on a separate pool of I/O
+//                   threads and suspend until it returns its result
+//  - sleep_for(d):  suspend for at least the duration d
+//  - schedule():    suspend and make the rest of the coroutine available to
+//                   be stolen by other workers
+//  - sync_wait(t):  run the task t and return its result. The calling worker
+//                   runs other jobs while t is suspended
+//
+// Only available when compiling with C++20 coroutine support. With schedulers
+// other than Parlay's, coroutines are resumed directly on the thread that
+// completed the operation that they were waiting for.
+// ----------------------------------------------------------------------------
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <cassert>
+#include <cstddef>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "parallel.h"
+#include "portability.h"
+
+#include "internal/work_stealing_job.h"
+
+// The number of threads used to run the callables passed to blocking().
+// These threads spend their time waiting on I/O, so they do not compete
+// with the workers for CPU time.
+//
+// Default: 8
+#ifndef PARLAY_BLOCKING_THREADS
+#define PARLAY_BLOCKING_THREADS 8
+#endif
+
+namespace parlay {
+namespace internal {
+
+#if defined(PARLAY_USING_PARLAY_SCHEDULER)
+
+// A job that resumes a suspended coroutine. Detached, since the coroutine
+// may finish and destroy whatever is waiting for it before the job returns.
+struct resume_job : WorkStealingJob {
+  explicit resume_job(std::coroutine_handle<> h_) : WorkStealingJob(detached_t{}), h(h_) { }
+  void execute() override { h.resume(); }
+ private:
+  std::coroutine_handle<> h;
+};
+
+#endif
+
+// Identifies the scheduler that a suspended coroutine should be resumed on
+struct resumption_target {
+#if defined(PARLAY_USING_PARLAY_SCHEDULER)
+  scheduler_type* owner{&get_current_scheduler()};
+#endif
+
+  // Resume h on the scheduler. Safe to call from any thread.
+  void resume(std::coroutine_handle<> h) const {
+#if defined(PARLAY_USING_PARLAY_SCHEDULER)
+    owner->inject(new resume_job(h));
+#else
+    h.resume();
+#endif
+  }
+};
+
+// A pool of threads for running blocking operations
+class blocking_pool {
+ public:
+  explicit blocking_pool(size_t num_threads) {
+    for (size_t i = 0; i < num_threads; i++) {
+      threads.emplace_back([this]() { run(); });
+    }
+  }
+
+  ~blocking_pool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    cv.notify_all();
+    for (auto& t : threads) t.join();
+  }
+
+  void submit(std::function<void()> f) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      pending.push(std::move(f));
+    }
+    cv.notify_one();
+  }
+
+ private:
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::queue<std::function<void()>> pending;
+  std::vector<std::thread> threads;
+  bool stopping{false};
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      cv.wait(lock, [&]() { return stopping || !pending.empty(); });
+      if (pending.empty()) return;
+      auto f = std::move(pending.front());
+      pending.pop();
+      lock.unlock();
+      f();
+      lock.lock();
+    }
+  }
+};
+
+extern inline blocking_pool& get_blocking_pool() {
+  static blocking_pool pool(PARLAY_BLOCKING_THREADS);
+  return pool;
+}
+
+// A thread that resumes sleeping coroutines when their deadline passes
+class timer_thread {
+  using clock = std::chrono::steady_clock;
+
+  struct timer {
+    clock::time_point deadline;
+    std::coroutine_handle<> h;
+    resumption_target target;
+    bool operator>(const timer& other) const { return deadline > other.deadline; }
+  };
+
+ public:
+  timer_thread() : thread([this]() { run(); }) { }
+
+  ~timer_thread() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    cv.notify_all();
+    thread.join();
+  }
+
+  void add(clock::time_point deadline, std::coroutine_handle<> h, resumption_target target) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      timers.push(timer{deadline, h, target});
+    }
+    cv.notify_one();
+  }
+
+ private:
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::priority_queue<timer, std::vector<timer>, std::greater<>> timers;
+  bool stopping{false};
+  std::thread thread;
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+      if (timers.empty()) {
+        cv.wait(lock);
+      }
+      else if (auto deadline = timers.top().deadline; clock::now() < deadline) {
+        cv.wait_until(lock, deadline);
+      }
+      else {
+        auto t = timers.top();
+        timers.pop();
+        lock.unlock();
+        t.target.resume(t.h);
+        lock.lock();
+      }
+    }
+  }
+};
+
+extern inline timer_thread& get_timer_thread() {
+  static timer_thread timers;
+  return timers;
+}
+
+// Storage for the result of a task or blocking operation
+template<typename T>
+struct result_holder {
+  std::optional<T> value;
+  std::exception_ptr exception;
+
+  template<typename F>
+  void set_from(F&& f) {
+#if defined(PARLAY_EXCEPTIONS_ENABLED)
+    try { value.emplace(std::forward<F>(f)()); }
+    catch (...) { exception = std::current_exception(); }
+#else
+    value.emplace(std::forward<F>(f)());
+#endif
+  }
+
+  T get() {
+#if defined(PARLAY_EXCEPTIONS_ENABLED)
+    if (exception) std::rethrow_exception(exception);
+#endif
+    assert(value.has_value());
+    return std::move(*value);
+  }
+};
+
+template<>
+struct result_holder<void> {
+  std::exception_ptr exception;
+
+  template<typename F>
+  void set_from(F&& f) {
+#if defined(PARLAY_EXCEPTIONS_ENABLED)
+    try { std::forward<F>(f)(); }
+    catch (...) { exception = std::current_exception(); }
+#else
+    std::forward<F>(f)();
+#endif
+  }
+
+  void get() {
+#if defined(PARLAY_EXCEPTIONS_ENABLED)
+    if (exception) std::rethrow_exception(exception);
+#endif
+  }
+};
+
+template<typename T>
+struct task_promise_base {
+  std::coroutine_handle<> continuation;
+  std::atomic<bool> finished{false};
+  result_holder<T> result;
+
+  void unhandled_exception() noexcept { result.exception = std::current_exception(); }
+
+  std::suspend_always initial_suspend() noexcept { return {}; }
+
+  // On completion, transfer control to the coroutine that is awaiting
+  // this one, if any. Otherwise, notify sync_wait.
+  struct final_awaiter {
+    bool await_ready() noexcept { return false; }
+    template<typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+      auto& promise = h.promise();
+      if (promise.continuation) return promise.continuation;
+      promise.finished.store(true, std::memory_order_release);
+      return std::noop_coroutine();
+    }
+    void await_resume() noexcept { }
+  };
+
+  final_awaiter final_suspend() noexcept { return {}; }
+};
+
+template<typename T>
+struct task_promise : task_promise_base<T> {
+  template<typename U>
+  void return_value(U&& value) { this->result.value.emplace(std::forward<U>(value)); }
+};
+
+template<>
+struct task_promise<void> : task_promise_base<void> {
+  void return_void() noexcept { }
+};
+
+}  // namespace internal
+
+template<typename T = void>
+class [[nodiscard]] task {
+ public:
+  struct promise_type : internal::task_promise<T> {
+    task get_return_object() noexcept {
+      return task{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+  };
+
+  task() = default;
+  task(task&& other) noexcept : h(std::exchange(other.h, nullptr)) { }
+  task& operator=(task&& other) noexcept {
+    if (this != &other) {
+      if (h) h.destroy();
+      h = std::exchange(other.h, nullptr);
+    }
+    return *this;
+  }
+  ~task() { if (h) h.destroy(); }
+
+  // Awaiting a task starts it, and resumes the awaiting coroutine when it
+  // finishes, on whichever worker finished it
+  auto operator co_await() && noexcept {
+    struct awaiter {
+      std::coroutine_handle<promise_type> h;
+      bool await_ready() noexcept { return !h || h.done(); }
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        h.promise().continuation = awaiting;
+        return h;
+      }
+      T await_resume() { return h.promise().result.get(); }
+    };
+    return awaiter{h};
+  }
+
+ private:
+  template<typename U>
+  friend U sync_wait(task<U>&& t);
+
+  explicit task(std::coroutine_handle<promise_type> h_) : h(h_) { }
+
+  std::coroutine_handle<promise_type> h;
+};
+
+// Run the task t until it completes and return its result. While t is
+// suspended, the calling thread runs other jobs of the scheduler.
+template<typename T>
+T sync_wait(task<T>&& t) {
+  auto h = t.h;
+  assert(h && !h.done());
+  auto done = [&]() { return h.promise().finished.load(std::memory_order_acquire); };
+  h.resume();
+#if defined(PARLAY_USING_PARLAY_SCHEDULER)
+  internal::get_current_scheduler().wait_until(done);
+#else
+  while (!done()) std::this_thread::yield();
+#endif
+  return h.promise().result.get();
+}
+
+// Run f() on a separate thread and suspend the awaiting coroutine until it
+// returns. Use this for operations that block, such as reading a file, so
+// that they do not occupy a worker.
+template<typename F>
+auto blocking(F&& f) {
+  using R = std::invoke_result_t<std::decay_t<F>&>;
+
+  struct awaiter {
+    std::decay_t<F> f;
+    internal::result_holder<R> result;
+
+    bool await_ready() noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+      internal::resumption_target target;
+      internal::get_blocking_pool().submit([this, h, target]() {
+        result.set_from(f);
+        target.resume(h);
+      });
+    }
+    R await_resume() { return result.get(); }
+  };
+
+  return awaiter{std::forward<F>(f), {}};
+}
+
+// Suspend the awaiting coroutine for at least the given duration
+template<typename Rep, typename Period>
+auto sleep_for(std::chrono::duration<Rep, Period> duration) {
+  struct awaiter {
+    std::chrono::steady_clock::time_point deadline;
+
+    bool await_ready() noexcept { return std::chrono::steady_clock::now() >= deadline; }
+    void await_suspend(std::coroutine_handle<> h) {
+      internal::get_timer_thread().add(deadline, h, internal::resumption_target{});
+    }
+    void await_resume() noexcept { }
+  };
+
+  return awaiter{std::chrono::steady_clock::now() +
+                 std::chrono::duration_cast<std::chrono::steady_clock::duration>(duration)};
+}
+
+// Suspend the awaiting coroutine and make its continuation available to
+// other workers, e.g., so that several tasks started by a loop run in parallel
+inline auto schedule() {
+  struct awaiter {
+#if defined(PARLAY_USING_PARLAY_SCHEDULER)
+    bool await_ready() noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> h) {
+      auto job = new internal::resume_job(h);
+      if (internal::get_current_scheduler().try_spawn(job)) return true;
+      delete job;
+      return false;
+    }
+#else
+    bool await_ready() noexcept { return true; }
+    void await_suspend(std::coroutine_handle<>) noexcept { }
+#endif
+    void await_resume() noexcept { }
+  };
+  return awaiter{};
+}
+
+}  // namespace parlay
+
+#endif  // defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#endif  // PARLAY_COROUTINE_H_
@@ -0,0 +1,283 @@
+// An external-memory (out-of-core) parallel sort, for files of fixed-size
+// records that are larger than the memory that may be used to sort them.
+//
+// The sort is in two phases:
+//
+//  1. Run formation. The input file is memory mapped, and cut into runs of
+//     about half the memory budget each. Each run is copied into memory,
+//     sorted in parallel by parlay::sort_inplace, and appended to a
+//     temporary file by a background thread, while the next run is sorted.
+//
+//  2. Merge. The temporary file is memory mapped, and the runs are merged
+//     one chunk of the output at a time. Each chunk takes a window of the
+//     next records of every run, cut at the smallest of the last records
+//     of the windows, so that every record of the chunk comes before every
+//     record left after it. The windows of the next chunk are prefetched
+//     while the current chunk is merged, by a parallel tree of pairwise
+//     merges, and the previous chunk is written by the background thread.
+//
+// A single run is written directly to the output, so inputs that fit in the
+// memory budget are read and written once. Larger inputs are read and
+// written twice, which is optimal as long as the budget is at least about
+// sqrt(input size * page size), i.e. a few hundred MB for a 100 GB file.
+//
+// Records are copied as bytes, so the record type must be trivially copy
+// constructible and trivially destructible, like std::pair<int, int>, and
+// the file must hold a whole number of records, in the native byte order.
+
+#ifndef PARLAY_EXTERNAL_SORT_H_
+#define PARLAY_EXTERNAL_SORT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "io.h"
+#include "parallel.h"
+#include "portability.h"
+#include "primitives.h"
+#include "sequence.h"
+#include "slice.h"
+
+#include "internal/get_time.h"
+
+namespace parlay {
+
+struct external_sort_options {
+  // The number of bytes of memory to use for records, not counting the
+  // pages of the memory-mapped files, which the OS can evict as needed
+  size_t memory_budget = size_t{1} << 30;
+
+  // The name of the temporary file that holds the sorted runs. It is the
+  // output filename followed by ".runs" if left empty.
+  std::string temp_filename;
+};
+
+struct external_sort_stats {
+  size_t num_records = 0;
+  size_t num_runs = 0;
+  size_t bytes_read = 0;        // from the input and the temporary file
+  size_t bytes_written = 0;     // to the output and the temporary file
+  double run_seconds = 0;       // time spent forming runs
+  double merge_seconds = 0;     // time spent merging runs
+};
+
+namespace internal {
+
+// Writes sequences to the end of a file on a background thread, so that
+// writing one overlaps computing the next. At most one write is pending.
+template <typename T>
+class background_writer {
+ public:
+  explicit background_writer(const std::string& filename)
+      : name(filename), file(std::fopen(filename.c_str(), "wb")) {
+    if (file == nullptr) {
+      throw_exception_or_terminate<std::runtime_error>("external_sort: could not open " + name + " for writing");
+    }
+  }
+
+  background_writer(const background_writer&) = delete;
+  background_writer& operator=(const background_writer&) = delete;
+
+  ~background_writer() {
+    if (thread.joinable()) thread.join();
+    if (file != nullptr) std::fclose(file);
+  }
+
+  // Start writing data after whatever was written before
+  void write(sequence<T> data) {
+    wait();
+    pending = std::move(data);
+    thread = std::thread([this] {
+      failed = std::fwrite(pending.data(), sizeof(T), pending.size(), file) != pending.size();
+    });
+  }
+
+  // Wait for the pending write, if any, to finish
+  void wait() {
+    if (thread.joinable()) thread.join();
+    pending.clear();
+    if (failed) {
+      throw_exception_or_terminate<std::runtime_error>("external_sort: could not write to " + name);
+    }
+  }
+
+  void close() {
+    wait();
+    int result = std::fclose(file);
+    file = nullptr;
+    if (result != 0) {
+      throw_exception_or_terminate<std::runtime_error>("external_sort: could not write to " + name);
+    }
+  }
+
+ private:
+  std::string name;
+  std::FILE* file;
+  std::thread thread;
+  sequence<T> pending;
+  bool failed = false;
+};
+
+// Advise the OS that the memory-mapped bytes [begin, end) will be read soon,
+// so that it can read them from disk in the background
+inline void prefetch_mapped_range([[maybe_unused]] const void* begin, [[maybe_unused]] const void* end) {
+#if defined(PARLAY_POSIX_FILE_MAP) && !defined(PARLAY_USE_FALLBACK_FILE_MAP)
+  static const uintptr_t page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  auto first = reinterpret_cast<uintptr_t>(begin) / page_size * page_size;
+  auto last = reinterpret_cast<uintptr_t>(end);
+  if (last > first) posix_madvise(reinterpret_cast<void*>(first), last - first, POSIX_MADV_WILLNEED);
+#endif
+}
+
+// The size in bytes of the given file, or throws if it can not be read
+inline size_t external_sort_file_size(const std::string& filename) {
+  std::ifstream file(filename, std::ios::in | std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    throw_exception_or_terminate<std::runtime_error>("external_sort: could not open " + filename + " for reading");
+  }
+  return static_cast<size_t>(file.tellg());
+}
+
+// Merge the sorted ranges parts[lo, hi) by a tree of pairwise merges,
+// whose subtrees are merged in parallel
+template <typename T, typename Compare>
+sequence<T> merge_sorted_parts(const sequence<slice<const T*, const T*>>& parts,
+                               size_t lo, size_t hi, const Compare& less) {
+  if (hi - lo == 1) return parlay::to_sequence(parts[lo]);
+  if (hi - lo == 2) return parlay::merge(parts[lo], parts[lo + 1], less);
+  size_t mid = lo + (hi - lo) / 2;
+  sequence<T> left, right;
+  par_do([&]() { left = merge_sorted_parts<T>(parts, lo, mid, less); },
+         [&]() { right = merge_sorted_parts<T>(parts, mid, hi, less); });
+  return parlay::merge(left, right, less);
+}
+
+template <typename T, typename Compare>
+external_sort_stats external_sort(const std::string& input_filename, const std::string& output_filename,
+                                  const Compare& less, const external_sort_options& options) {
+  external_sort_stats stats;
+  size_t bytes = external_sort_file_size(input_filename);
+  if (bytes % sizeof(T) != 0) {
+    throw_exception_or_terminate<std::invalid_argument>("external_sort: the size of " + input_filename +
+        " is not a multiple of the record size " + std::to_string(sizeof(T)));
+  }
+  size_t n = bytes / sizeof(T);
+  stats.num_records = n;
+  if (n == 0) {
+    background_writer<T>(output_filename).close();
+    return stats;
+  }
+
+  // Runs take half of the budget, so that one can be sorted while the
+  // previous one is written
+  size_t run_len = (std::max)(size_t{1}, options.memory_budget / (2 * sizeof(T)));
+  size_t num_runs = (n - 1) / run_len + 1;
+  auto run_start = [&](size_t r) { return (std::min)(n, r * run_len); };
+  stats.num_runs = num_runs;
+
+  std::string temp_filename = options.temp_filename.empty() ? output_filename + ".runs" : options.temp_filename;
+
+  // ------------------------- Run formation --------------------------
+
+  internal::timer t("external_sort", true);
+  {
+    file_map input(input_filename);
+    const T* records = reinterpret_cast<const T*>(&*input.begin());
+    background_writer<T> writer(num_runs == 1 ? output_filename : temp_filename);
+    for (size_t r = 0; r < num_runs; r++) {
+      if (r + 1 < num_runs) prefetch_mapped_range(records + run_start(r + 1), records + run_start(r + 2));
+      size_t len = run_start(r + 1) - run_start(r);
+      auto run = sequence<T>::uninitialized(len);
+      parallel_for(0, len, [&](size_t i) {
+        std::memcpy(static_cast<void*>(run.data() + i), records + run_start(r) + i, sizeof(T));
+      });
+      parlay::sort_inplace(run, less);
+      writer.write(std::move(run));
+    }
+    writer.close();
+  }
+  stats.run_seconds = t.stop();
+  stats.bytes_read += bytes;
+  stats.bytes_written += bytes;
+  if (num_runs == 1) return stats;
+
+  // ----------------------------- Merge ------------------------------
+
+  // The chunk being merged takes a third of the budget, the level of
+  // merges that it is input to another third, and the previous chunk,
+  // while it is written, the last third
+  t.start();
+  {
+    file_map runs(temp_filename);
+    const T* records = reinterpret_cast<const T*>(&*runs.begin());
+    size_t window = (std::max)(size_t{1}, options.memory_budget / (3 * sizeof(T)) / num_runs);
+    auto next = sequence<size_t>::from_function(num_runs, [&](size_t r) { return run_start(r); });
+    auto window_end = [&](size_t r) { return (std::min)(run_start(r + 1), next[r] + window); };
+
+    background_writer<T> writer(output_filename);
+    size_t remaining = n;
+    while (remaining > 0) {
+      // The splitter is the smallest last record of the windows that do not
+      // reach the end of their run. Records up to it are in the windows.
+      const T* splitter = nullptr;
+      for (size_t r = 0; r < num_runs; r++) {
+        if (window_end(r) < run_start(r + 1)) {
+          const T* last = records + window_end(r) - 1;
+          if (splitter == nullptr || less(*last, *splitter)) splitter = last;
+        }
+      }
+
+      auto parts = sequence<slice<const T*, const T*>>::from_function(num_runs, [&](size_t r) {
+        const T* begin = records + next[r];
+        const T* end = records + window_end(r);
+        if (splitter != nullptr) end = std::upper_bound(begin, end, *splitter, less);
+        return make_slice(begin, end);
+      });
+      parallel_for(0, num_runs, [&](size_t r) {
+        next[r] += parts[r].size();
+        prefetch_mapped_range(records + next[r], records + window_end(r));
+      });
+
+      // Runs that have been fully merged contribute empty parts
+      auto nonempty = parlay::filter(parts, [](const auto& part) { return part.size() > 0; });
+      auto chunk = merge_sorted_parts<T>(nonempty, 0, nonempty.size(), less);
+      remaining -= chunk.size();
+      writer.write(std::move(chunk));
+    }
+    writer.close();
+  }
+  std::remove(temp_filename.c_str());
+  stats.merge_seconds = t.stop();
+  stats.bytes_read += bytes;
+  stats.bytes_written += bytes;
+  return stats;
+}
+
+}  // namespace internal
+
+// Sort the records of type T in the binary file input_filename by the given
+// comparison, and write them to output_filename, using about the memory
+// budget given in the options, plus the page cache of the memory-mapped
+// files. Returns the number of runs and the bytes and time of each phase.
+template <typename T, typename Compare = std::less<>>
+external_sort_stats external_sort(const std::string& input_filename, const std::string& output_filename,
+                                  Compare&& less = {}, const external_sort_options& options = {}) {
+  static_assert(std::is_trivially_copy_constructible_v<T> && std::is_trivially_destructible_v<T>);
+  static_assert(std::is_invocable_r_v<bool, Compare, const T&, const T&>);
+  return internal::external_sort<T>(input_filename, output_filename, less, options);
+}
+
+}  // namespace parlay
+
+#endif  // PARLAY_EXTERNAL_SORT_H_
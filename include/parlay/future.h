@@ -0,0 +1,160 @@
+#ifndef PARLAY_FUTURE_H_
+#define PARLAY_FUTURE_H_
+
+#include <cassert>
+
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "parallel.h"
+
+#include "internal/work_stealing_job.h"
+
+namespace parlay {
+
+// ----------------------------------------------------------------------------
+// Futures for computations that do not fit strictly nested fork-join. For
+// example, a DAG of tasks can be expressed by spawning each task as soon as
+// it is known, and having tasks get() the results of their dependencies:
+//
+//    auto words = parlay::spawn([&]() { return parse(text); });
+//    auto sorted = parlay::spawn([&]() { return parlay::sort(words.get()); });
+//    auto lengths = parlay::spawn([&]() { return count_lengths(words.get()); });
+//    use(sorted.get(), lengths.get());
+//
+// spawn(f) pushes a job onto the current worker's deque, where it can be
+// stolen by idle workers just like the right branch of a par_do. Calling
+// get() (or wait()) on a future whose job has not finished does not block the
+// worker, but runs other jobs until it has finished, including the future's
+// own job if nobody stole it. If the worker already has too many jobs
+// outstanding, spawn(f) runs f immediately instead.
+//
+// A future must be waited on by a worker of the scheduler that spawned it
+// (the thread that spawned it, or any task running in that scheduler). It
+// may be waited on outside of the execute_with_priority scope that spawned
+// it, in which case the waiting worker runs at the future's priority. A
+// future that is destroyed without being waited on waits for its job in its
+// destructor, since the job refers to state owned by the future.
+//
+// With schedulers other than Parlay's, spawn(f) runs f immediately.
+// ----------------------------------------------------------------------------
+
+namespace internal {
+
+template<typename T>
+struct future_job : WorkStealingJob {
+  std::optional<T> result;
+};
+
+template<>
+struct future_job<void> : WorkStealingJob { };
+
+template<typename T, typename F>
+struct future_job_impl : future_job<T> {
+  explicit future_job_impl(F&& f_) : f(std::forward<F>(f_)) { }
+  void execute() override {
+    if constexpr (std::is_void_v<T>) f();
+    else this->result.emplace(f());
+  }
+ private:
+  std::decay_t<F> f;
+};
+
+}  // namespace internal
+
+template<typename T>
+class future {
+
+  template<typename F>
+  friend auto spawn(F&& f) -> future<std::invoke_result_t<std::decay_t<F>&>>;
+
+ public:
+  future() = default;
+  future(future&&) noexcept = default;
+  future& operator=(future&& other) noexcept {
+    if (this != &other) {
+      wait_if_valid();
+      job = std::move(other.job);
+#if defined(PARLAY_USING_PARLAY_SCHEDULER)
+      owner = other.owner;
+      level = other.level;
+#endif
+    }
+    return *this;
+  }
+
+  ~future() { wait_if_valid(); }
+
+  // True if the future refers to a spawned job whose result has not yet been taken
+  [[nodiscard]] bool valid() const noexcept { return job != nullptr; }
+
+  // True if the job has finished, so get() will not have to wait
+  [[nodiscard]] bool ready() const noexcept {
+    assert(valid());
+    return job->finished();
+  }
+
+  // Wait for the job to finish, running other jobs in the meantime
+  void wait() const {
+    assert(valid());
+    if (job->finished()) return;
+#if defined(PARLAY_USING_PARLAY_SCHEDULER)
+    if (internal::scheduler_type::get_current_scheduler() == owner) {
+      // The job is on a deque of the level that it was spawned at, which
+      // thieves skip unless that level has active work, so wait at it
+      auto done = [&]() { return job->finished(); };
+      if (owner->priority_level() == level) owner->wait_until(done);
+      else owner->run_with_priority(level, [&]() { owner->wait_until(done); });
+    }
+    else {
+      job->wait();
+    }
+#else
+    job->wait();
+#endif
+  }
+
+  // Wait for the job to finish and return its result. The future is no
+  // longer valid afterwards.
+  T get() {
+    wait();
+    auto finished_job = std::move(job);
+    if constexpr (!std::is_void_v<T>) {
+      return std::move(*(finished_job->result));
+    }
+  }
+
+ private:
+  std::unique_ptr<internal::future_job<T>> job;
+#if defined(PARLAY_USING_PARLAY_SCHEDULER)
+  internal::scheduler_type* owner{nullptr};
+  unsigned int level{internal::scheduler_type::normal_priority};
+#endif
+
+  void wait_if_valid() {
+    if (valid()) wait();
+  }
+};
+
+// Spawn f() to run asynchronously, potentially in parallel with the caller
+// and other spawned jobs. Returns a future for the result of f().
+template<typename F>
+auto spawn(F&& f) -> future<std::invoke_result_t<std::decay_t<F>&>> {
+  using T = std::invoke_result_t<std::decay_t<F>&>;
+  future<T> result;
+  result.job = std::make_unique<internal::future_job_impl<T, F>>(std::forward<F>(f));
+#if defined(PARLAY_USING_PARLAY_SCHEDULER)
+  result.owner = &internal::get_current_scheduler();
+  result.level = result.owner->priority_level();
+  if (!result.owner->try_spawn(result.job.get())) (*result.job)();
+#else
+  (*result.job)();
+#endif
+  return result;
+}
+
+}  // namespace parlay
+
+#endif  // PARLAY_FUTURE_H_
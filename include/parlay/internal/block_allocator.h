@@ -4,6 +4,15 @@
 // global pool if empty, and returns list_length elements to the global
 // pool when local pool=2*list_length.
 //
+// The global pool is a set of lock-free stacks of whole lists, sharded by
+// thread, so that threads that exchange lists at the same time mostly
+// touch different stacks. A thread returns lists to its own shard and
+// takes them from its own shard first, then from the others.
+//
+// Memory is obtained in buffers of list_length blocks, which are kept until
+// the allocator is cleared, or until trim() finds that every block of a
+// buffer is in the global pool and returns it to the system.
+//
 // Keeps track of number of allocated elements. Much more efficient
 // than a general purpose allocator.
 //
@@ -19,9 +28,13 @@
 
 #include <algorithm>
 #include <atomic>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <new>
 #include <optional>
+#include <thread>
+#include <vector>
 
 #include "../utilities.h"
 #include "../thread_specific.h"
@@ -31,7 +44,6 @@
 #include "memory_size.h"
 
 // IWYU pragma: no_include <array>
-// IWYU pragma: no_include <vector>
 
 namespace parlay {
 namespace internal {
@@ -41,6 +53,7 @@ struct block_allocator {
 
   static inline constexpr size_t default_list_bytes = (1 << 18) - 64;  // in bytes
   static inline constexpr size_t min_alignment = 128;  // for cache line padding
+  static inline constexpr size_t max_shards = 64;
 
   struct block {
     block* next;
@@ -53,8 +66,13 @@ struct block_allocator {
     local_list() : sz(0), head(nullptr), mid(nullptr) {}
   };
 
+  struct alignas(128) global_shard {
+    hazptr_stack<block*> lists;
+  };
+
   hazptr_stack<std::byte*> allocated_buffers;
-  hazptr_stack<block*> global_stack;
+  size_t num_shards;                          // a power of two
+  std::unique_ptr<global_shard[]> global_pool;
   ThreadSpecific<local_list> my_local_list;
 
   size_t block_size;
@@ -63,6 +81,31 @@ struct block_allocator {
   size_t max_blocks;
   std::atomic<size_t> blocks_allocated;
 
+  static size_t default_num_shards() {
+    size_t threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    size_t shards = 1;
+    while (shards < threads && shards < max_shards) shards *= 2;
+    return shards;
+  }
+
+  size_t my_shard() const { return my_thread_id() & (num_shards - 1); }
+
+  void push_list(block* list) {
+    global_pool[my_shard()].lists.push(list);
+  }
+
+  std::optional<block*> pop_list() {
+    size_t start = my_shard();
+    for (size_t i = 0; i < num_shards; i++) {
+      auto& lists = global_pool[(start + i) & (num_shards - 1)].lists;
+      if (!lists.empty()) {
+        std::optional<block*> list = lists.pop();
+        if (list) return list;
+      }
+    }
+    return {};
+  }
+
   block* get_block(std::byte* buffer, size_t i) const {
     // Since block is an aggregate type, it has implicit lifetime, so the following code
     // is defined behaviour in C++20 even if we haven't yet called a constructor of block.
@@ -90,7 +133,10 @@ struct block_allocator {
   }
 
   size_t num_used_blocks() {
-    size_t free_blocks = global_stack.size()*list_length;
+    size_t free_blocks = 0;
+    for (size_t i = 0; i < num_shards; i++) {
+      free_blocks += global_pool[i].lists.size() * list_length;
+    }
     my_local_list.for_each([&](auto&& list) {
       free_blocks += list.sz;
     });
@@ -111,7 +157,7 @@ struct block_allocator {
   // Either grab a list from the global pool, or if there is none
   // then allocate a new list
   auto get_list() -> block* {
-    std::optional<block*> rem = global_stack.pop();
+    std::optional<block*> rem = pop_list();
     if (rem) return *rem;
     std::byte* buffer = allocate_blocks(list_length);
     return initialize_list(buffer);
@@ -134,6 +180,8 @@ struct block_allocator {
     [[maybe_unused]] size_t reserved_blocks = 0,
     size_t list_length_ = 0,
     size_t max_blocks_ = 0) :
+      num_shards(default_num_shards()),
+      global_pool(std::make_unique<global_shard[]>(num_shards)),
       my_local_list(),                                                               // Each block needs to be at least
       block_size(std::max<size_t>(block_size_, sizeof(block))),    // <------------- // large enough to hold the struct
       block_align(std::align_val_t{std::max<size_t>(block_align_, min_alignment)}),  // representing a free block.
@@ -164,12 +212,66 @@ struct block_allocator {
       // throw away all allocated memory
       std::optional<std::byte*> x;
       while ((x = allocated_buffers.pop())) ::operator delete(*x, block_align);
-      global_stack.clear();
+      for (size_t i = 0; i < num_shards; i++) global_pool[i].lists.clear();
       blocks_allocated.store(0);
       return true;
     }
   }
 
+  // Return to the system every buffer whose blocks are all in the global
+  // pool. Blocks in the local lists of threads are kept, and so are the
+  // buffers that they belong to. Returns the number of bytes released.
+  //
+  // This operation is safe to perform concurrently with alloc and free,
+  // but not with clear
+  size_t trim() {
+    std::vector<block*> free_blocks;
+    std::optional<block*> list;
+    while ((list = pop_list())) {
+      for (block* b = *list; b != nullptr; b = b->next) free_blocks.push_back(b);
+    }
+    if (free_blocks.empty()) return 0;
+    std::sort(free_blocks.begin(), free_blocks.end(), std::less<block*>());
+
+    // Every list in the global pool has list_length blocks, and so does
+    // every buffer, so the blocks that are kept still form whole lists
+    std::vector<std::byte*> buffers;
+    std::optional<std::byte*> buffer;
+    while ((buffer = allocated_buffers.pop())) buffers.push_back(*buffer);
+    std::vector<bool> released(free_blocks.size(), false);
+    size_t num_released = 0;
+    for (std::byte* b : buffers) {
+      auto first = std::lower_bound(free_blocks.begin(), free_blocks.end(), get_block(b, 0), std::less<block*>());
+      if (static_cast<size_t>(free_blocks.end() - first) >= list_length &&
+          *(first + (list_length - 1)) == get_block(b, list_length - 1)) {
+        auto i = first - free_blocks.begin();
+        std::fill(released.begin() + i, released.begin() + i + list_length, true);
+        ::operator delete(b, block_align);
+        num_released += list_length;
+      } else {
+        allocated_buffers.push(b);
+      }
+    }
+
+    block* head = nullptr;
+    size_t sz = 0;
+    for (size_t i = 0; i < free_blocks.size(); i++) {
+      if (released[i]) continue;
+      block* b = free_blocks[i];
+      b->next = head;
+      head = b;
+      if (++sz == list_length) {
+        push_list(head);
+        head = nullptr;
+        sz = 0;
+      }
+    }
+    assert(sz == 0);
+
+    blocks_allocated.fetch_sub(num_released);
+    return num_released * block_size;
+  }
+
   ~block_allocator() {
     [[maybe_unused]] auto cleared = clear();
 #if !defined(NDEBUG) && !defined(PARLAY_ALLOC_ALLOW_LEAK)
@@ -185,7 +287,7 @@ struct block_allocator {
     if (my_local_list->sz == list_length+1) {
       my_local_list->mid = my_local_list->head;
     } else if (my_local_list->sz == 2*list_length) {
-      global_stack.push(my_local_list->mid->next);
+      push_list(my_local_list->mid->next);
       my_local_list->mid->next = nullptr;
       my_local_list->sz = list_length;
     }
@@ -212,7 +314,7 @@ struct block_allocator {
         // Looks like the task got stolen and the new thread already had a
         // non-empty local list, so we can push the new one into the global
         // pool for someone else to use in the future
-        global_stack.push(new_list);
+        push_list(new_list);
       }
     }
 
@@ -0,0 +1,286 @@
+// In-place parallel partitioning of a range into buckets by block permutation,
+// following the scheme of In-place Parallel Super Scalar Samplesort (IPS4o,
+// Axtmann, Witt, Ferizovic and Sanders, 2017). Unlike a counting sort, which
+// writes every element to a second array of the same size, it only needs
+// buffers of a few blocks per bucket for each stripe of the input, so sorts
+// built on top of it do not double the memory used by the input.
+//
+// The partition is in three phases:
+//
+//  1. Local classification. The input is cut into stripes, one per task.
+//     Each task classifies the elements of its stripe into a buffer block
+//     per bucket, and writes each buffer back to the front of its stripe
+//     whenever it fills up. Each stripe ends up with a prefix of full
+//     blocks, each of a single bucket, followed by empty space.
+//
+//  2. Block permutation. Every bucket gets a block-aligned region of the
+//     range, large enough for all of its full blocks. Tasks repeatedly take
+//     an unplaced block from some region and swap it into the next slot of
+//     the region of its bucket, until every full block is in its region.
+//
+//  3. Cleanup. The elements left in the buffers, and those of the last block
+//     of a bucket that overlaps the next bucket, fill the gaps at both ends
+//     of each bucket.
+//
+// Elements are moved by relocation, so the element type must be trivially
+// relocatable. The partition is not stable.
+
+#ifndef PARLAY_INTERNAL_BLOCK_PARTITION_H_
+#define PARLAY_INTERNAL_BLOCK_PARTITION_H_
+
+#include <cassert>
+#include <cstddef>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include "sequence_ops.h"
+#include "uninitialized_sequence.h"
+
+#include "../monoid.h"
+#include "../parallel.h"
+#include "../relocation.h"
+#include "../sequence.h"
+#include "../slice.h"
+#include "../type_traits.h"
+
+namespace parlay {
+namespace internal {
+
+// The number of elements in a block of the partition. Blocks of about 2KB
+// are large enough to make the block moves of the permutation cheap, and
+// small enough that the buffers of 256 buckets fit in the L2 cache.
+template <typename T>
+constexpr size_t block_partition_block_size() {
+  return (std::max)(size_t{1}, size_t{2048} / sizeof(T));
+}
+
+// The read and write pointers of the region of one bucket during the block
+// permutation. Slots [begin, write) hold blocks of the bucket, and slots
+// [write, read) hold blocks that are yet to be moved to their own bucket.
+struct alignas(64) block_partition_pointers {
+  std::atomic_flag lock = ATOMIC_FLAG_INIT;
+  size_t write{0};
+  size_t read{0};
+
+  void acquire() { while (lock.test_and_set(std::memory_order_acquire)) std::this_thread::yield(); }
+  void release() { lock.clear(std::memory_order_release); }
+};
+
+// Permute the elements of A so that the elements of each bucket, numbered
+// 0 through num_buckets - 1 by classify, are contiguous and in order of
+// bucket. Returns the offsets of the buckets, num_buckets + 1 of them, the
+// last being the size of A. The work is split into at most num_stripes
+// tasks, each of which needs num_buckets blocks of buffer space.
+template <typename Iterator, typename Classify>
+sequence<size_t> block_partition_inplace(slice<Iterator, Iterator> A,
+                                         size_t num_buckets,
+                                         const Classify& classify,
+                                         size_t num_stripes) {
+  using T = typename slice<Iterator, Iterator>::value_type;
+  static_assert(is_trivially_relocatable_v<T>);
+
+  constexpr size_t B = block_partition_block_size<T>();
+  size_t n = A.size();
+  size_t k = num_buckets;
+  if (n == 0) return sequence<size_t>(k + 1, 0);
+
+  // Stripes are a whole number of blocks long, except maybe the last. There
+  // are never so many that their buffers would hold more than the input.
+  num_stripes = (std::max)(size_t{1}, (std::min)(num_stripes, n / (k * B)));
+  size_t stripe_len = ((n - 1) / num_stripes / B + 1) * B;
+  num_stripes = (n - 1) / stripe_len + 1;
+  auto stripe_start = [&](size_t m) { return m * stripe_len; };
+  auto stripe_end = [&](size_t m) { return (std::min)(n, (m + 1) * stripe_len); };
+
+  auto buffers = uninitialized_sequence<T>(num_stripes * k * B);
+  auto buffered = sequence<size_t>(num_stripes * k);       // elements held in each buffer
+  auto counts = sequence<size_t>(num_stripes * k);         // elements of each bucket in each stripe
+  auto blocks_end = sequence<size_t>::uninitialized(num_stripes);
+
+  // ----------------------- Local classification -----------------------
+
+  parallel_for(0, num_stripes, [&](size_t m) {
+    T* buffer = buffers.begin() + m * k * B;
+    size_t* held = buffered.begin() + m * k;
+    size_t* count = counts.begin() + m * k;
+    size_t write = stripe_start(m);
+    for (size_t j = stripe_start(m); j < stripe_end(m); j++) {
+      size_t b = classify(A[j]);
+      assert(b < k);
+      count[b]++;
+      T* bucket_buffer = buffer + b * B;
+      parlay::uninitialized_relocate_n(A.begin() + j, 1, bucket_buffer + held[b]);
+      if (++held[b] == B) {
+        parlay::uninitialized_relocate_n(bucket_buffer, B, A.begin() + write);
+        write += B;
+        held[b] = 0;
+      }
+    }
+    blocks_end[m] = write;
+  }, 1);
+
+  auto offsets = sequence<size_t>::from_function(k + 1, [&](size_t i) -> size_t {
+    size_t total = 0;
+    if (i < k) for (size_t m = 0; m < num_stripes; m++) total += counts[m * k + i];
+    return total;
+  });
+  scan_inplace(make_slice(offsets), plus<size_t>());
+  assert(offsets[k] == n);
+
+  // Bucket i gets the block-aligned region [region_start(i), region_start(i+1))
+  auto region_start = [&](size_t i) { return (offsets[i] + B - 1) / B * B; };
+
+  // The number of full blocks of each bucket
+  auto full_blocks = sequence<size_t>::from_function(k, [&](size_t i) {
+    size_t held = 0;
+    for (size_t m = 0; m < num_stripes; m++) held += buffered[m * k + i];
+    return (offsets[i + 1] - offsets[i] - held) / B;
+  });
+
+  // ------------------------ Block permutation -------------------------
+
+  // First move the full blocks inside each region to the front of the
+  // region, so that its unplaced blocks are contiguous. Full blocks are
+  // only ever at the front of a stripe, so a region can be handled stripe
+  // by stripe, and only the few stripes that it overlaps need any moves.
+  auto pointers = std::make_unique<block_partition_pointers[]>(k);
+  parallel_for(0, k, [&](size_t i) {
+    size_t start = region_start(i);
+    size_t end = (std::min)(region_start(i + 1), n);
+    if (start >= end) {
+      pointers[i].write = pointers[i].read = start;
+      return;
+    }
+    size_t full = 0;
+    for (size_t m = start / stripe_len; m <= (end - 1) / stripe_len; m++) {
+      size_t lo = (std::max)(start, stripe_start(m));
+      size_t hi = (std::min)(end, blocks_end[m]);
+      if (hi > lo) full += hi - lo;
+    }
+    size_t split = start + full;
+
+    // Fill the empty slots before split with full blocks from after it
+    size_t empty = start, last_full = end;
+    while (true) {
+      while (empty < split && empty < blocks_end[empty / stripe_len]) empty = blocks_end[empty / stripe_len];
+      if (empty >= split) break;
+      while (last_full - 1 >= blocks_end[(last_full - 1) / stripe_len]) {
+        last_full = (std::max)(blocks_end[(last_full - 1) / stripe_len], stripe_start((last_full - 1) / stripe_len));
+      }
+      assert(last_full - B >= split);
+      parlay::uninitialized_relocate_n(A.begin() + (last_full - B), B, A.begin() + empty);
+      last_full -= B;
+      empty += B;
+    }
+    pointers[i].write = start;
+    pointers[i].read = split;
+  }, 1);
+
+  // A block whose slot goes past the end of A is put here instead. Only the
+  // last block of the last bucket can, since every other slot is within A.
+  auto overflow = uninitialized_sequence<T>(B);
+  auto swap_buffers = uninitialized_sequence<T>(num_stripes * 2 * B);
+
+  parallel_for(0, num_stripes, [&](size_t m) {
+    T* current = swap_buffers.begin() + m * 2 * B;
+    T* next = current + B;
+    size_t first = m * k / num_stripes;
+    for (size_t t = 0; t < k; t++) {
+      auto& source = pointers[(first + t) % k];
+      while (true) {
+        source.acquire();
+        if (source.read <= source.write) {
+          source.release();
+          break;
+        }
+        source.read -= B;
+        parlay::uninitialized_relocate_n(A.begin() + source.read, B, current);
+        source.release();
+
+        // Swap the block into its bucket until it lands in an empty slot
+        while (true) {
+          size_t d = classify(*current);
+          auto& dest = pointers[d];
+          dest.acquire();
+          while (dest.write < dest.read && classify(A[dest.write]) == d) dest.write += B;
+          size_t slot = dest.write;
+          dest.write += B;
+          if (slot < dest.read) {
+            parlay::uninitialized_relocate_n(A.begin() + slot, B, next);
+            parlay::uninitialized_relocate_n(current, B, A.begin() + slot);
+            dest.release();
+            std::swap(current, next);
+          }
+          else {
+            if (slot + B > n) parlay::uninitialized_relocate_n(current, B, overflow.begin());
+            else parlay::uninitialized_relocate_n(current, B, A.begin() + slot);
+            dest.release();
+            break;
+          }
+        }
+      }
+    }
+  }, 1);
+
+  // ----------------------------- Cleanup ------------------------------
+
+  // Save the elements of the last block of each bucket that are past the
+  // end of the bucket, since they are in the way of the next bucket. The
+  // overflow block, if any, is moved into place here too.
+  auto spilled = uninitialized_sequence<T>(k * B);
+  auto num_spilled = sequence<size_t>(k);
+  parallel_for(0, k, [&](size_t i) {
+    if (full_blocks[i] == 0) return;
+    size_t end = pointers[i].write;
+    assert(end == region_start(i) + full_blocks[i] * B);
+    size_t last = end - B;
+    size_t bucket_end = offsets[i + 1];
+    if (end > n) {
+      parlay::uninitialized_relocate_n(overflow.begin(), bucket_end - last, A.begin() + last);
+      parlay::uninitialized_relocate_n(overflow.begin() + (bucket_end - last), end - bucket_end, spilled.begin() + i * B);
+    }
+    else if (end > bucket_end) {
+      parlay::uninitialized_relocate_n(A.begin() + bucket_end, end - bucket_end, spilled.begin() + i * B);
+    }
+    num_spilled[i] = (end > bucket_end) ? end - bucket_end : 0;
+  }, 1);
+
+  // Fill the gaps at the start and end of each bucket with its
+  // spilled elements and the elements left in the buffers
+  parallel_for(0, k, [&](size_t i) {
+    size_t bucket_start = offsets[i], bucket_end = offsets[i + 1];
+    size_t gap_end = bucket_end, rest_start = bucket_end;
+    if (full_blocks[i] > 0) {
+      gap_end = region_start(i);
+      rest_start = (std::min)(pointers[i].write, bucket_end);
+    }
+    size_t pos = bucket_start;
+    auto fill = [&](T* source, size_t count) {
+      while (count > 0) {
+        if (pos == gap_end) pos = rest_start;
+        size_t len = (std::min)(count, (pos < gap_end ? gap_end : bucket_end) - pos);
+        assert(len > 0);
+        parlay::uninitialized_relocate_n(source, len, A.begin() + pos);
+        source += len;
+        pos += len;
+        count -= len;
+      }
+    };
+    fill(spilled.begin() + i * B, num_spilled[i]);
+    for (size_t m = 0; m < num_stripes; m++) {
+      fill(buffers.begin() + (m * k + i) * B, buffered[m * k + i]);
+    }
+    assert(pos == bucket_end || (pos == gap_end && rest_start == bucket_end));
+  }, 1);
+
+  return offsets;
+}
+
+}  // namespace internal
+}  // namespace parlay
+
+#endif  // PARLAY_INTERNAL_BLOCK_PARTITION_H_
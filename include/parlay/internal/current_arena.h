@@ -0,0 +1,23 @@
+// The arena that parlay::arena_allocator allocates from on the current
+// thread (see arena.h). The fork-join scheduler passes it on to the workers
+// that run stolen jobs, so that a parallel algorithm running inside an
+// arena scope allocates from the arena on every worker.
+
+#ifndef PARLAY_INTERNAL_CURRENT_ARENA_H_
+#define PARLAY_INTERNAL_CURRENT_ARENA_H_
+
+namespace parlay {
+
+class arena;
+
+namespace internal {
+
+inline arena*& current_arena() noexcept {
+  static thread_local arena* a = nullptr;
+  return a;
+}
+
+}  // namespace internal
+}  // namespace parlay
+
+#endif  // PARLAY_INTERNAL_CURRENT_ARENA_H_
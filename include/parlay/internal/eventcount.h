@@ -0,0 +1,111 @@
+// An eventcount, used by the scheduler to park idle workers and wake them
+// when work arrives. A thread that wants to sleep until some condition
+// holds does
+//
+//    auto key = ec.prepare_wait();
+//    if (condition()) ec.cancel_wait();
+//    else ec.wait(key);
+//
+// and a thread that makes the condition true calls ec.notify_one() or
+// ec.notify_all() afterwards. Checking the condition between prepare_wait
+// and wait guarantees that a notification is never lost, and notifying
+// costs a single load when nobody is waiting.
+//
+// On Linux, waiting and waking use a futex on a 32-bit epoch directly, so
+// notify_one wakes exactly one sleeping thread with a single system call.
+// Elsewhere, they fall back to parlay::atomic_wait.
+
+#ifndef PARLAY_INTERNAL_EVENTCOUNT_H_
+#define PARLAY_INTERNAL_EVENTCOUNT_H_
+
+#include <cstdint>
+
+#include <atomic>
+
+#if defined(__linux__)
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include "atomic_wait.h"
+#endif
+
+namespace parlay {
+namespace internal {
+
+class eventcount {
+ public:
+  using key_type = uint32_t;
+
+  // Announce that the calling thread is about to wait. The condition must
+  // be checked after this returns, and before calling wait.
+  key_type prepare_wait() noexcept {
+    waiters.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return epoch.load(std::memory_order_acquire);
+  }
+
+  // Withdraw a prepare_wait without waiting, e.g., if the condition holds
+  void cancel_wait() noexcept {
+    waiters.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  // Sleep until notified by a notification that happened after the
+  // matching prepare_wait. May wake up spuriously.
+  void wait(key_type key) noexcept {
+    while (epoch.load(std::memory_order_acquire) == key) {
+      futex_wait(key);
+    }
+    waiters.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  void notify_one() noexcept {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_relaxed) == 0) return;
+    epoch.fetch_add(1, std::memory_order_release);
+    futex_wake(false);
+  }
+
+  void notify_all() noexcept {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_relaxed) == 0) return;
+    epoch.fetch_add(1, std::memory_order_release);
+    futex_wake(true);
+  }
+
+  // The number of threads between prepare_wait and the end of wait
+  [[nodiscard]] uint32_t num_waiters() const noexcept {
+    return waiters.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<key_type> epoch{0};
+  std::atomic<uint32_t> waiters{0};
+
+#if defined(__linux__)
+  static_assert(sizeof(std::atomic<key_type>) == sizeof(int) && std::atomic<key_type>::is_always_lock_free);
+
+  void futex_wait(key_type key) noexcept {
+    syscall(SYS_futex, reinterpret_cast<int*>(&epoch), FUTEX_WAIT_PRIVATE, static_cast<int>(key), nullptr, nullptr, 0);
+  }
+
+  void futex_wake(bool all) noexcept {
+    syscall(SYS_futex, reinterpret_cast<int*>(&epoch), FUTEX_WAKE_PRIVATE, all ? INT_MAX : 1, nullptr, nullptr, 0);
+  }
+#else
+  void futex_wait(key_type key) noexcept {
+    parlay::atomic_wait(&epoch, key);
+  }
+
+  void futex_wake(bool all) noexcept {
+    if (all) parlay::atomic_notify_all(&epoch);
+    else parlay::atomic_notify_one(&epoch);
+  }
+#endif
+};
+
+}  // namespace internal
+}  // namespace parlay
+
+#endif  // PARLAY_INTERNAL_EVENTCOUNT_H_
@@ -0,0 +1,96 @@
+// Adaptive choice of the granularity of parallel loops. A granularity
+// controller remembers how long an iteration of a loop took in previous
+// calls, so later calls can pick a granularity immediately instead of
+// timing a sequential prefix of the loop. The estimate is an exponentially
+// weighted moving average of the observed iteration times, so it follows
+// loops whose cost changes slowly between calls.
+
+#ifndef PARLAY_INTERNAL_GRANULARITY_H_
+#define PARLAY_INTERNAL_GRANULARITY_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+
+// True if parallel_for calls that do not specify a granularity should use a
+// granularity controller for each loop body type, instead of timing a
+// sequential prefix on every call.
+//
+// Default: false
+#ifndef PARLAY_ADAPTIVE_GRANULARITY
+#define PARLAY_ADAPTIVE_GRANULARITY false
+#endif
+
+
+// The amount of sequential work, in nanoseconds, that adaptive granularity
+// aims to put into each leaf of a parallel loop.
+//
+// Default: 2000 (2 microseconds)
+#ifndef PARLAY_ADAPTIVE_GRANULARITY_TARGET_NS
+#define PARLAY_ADAPTIVE_GRANULARITY_TARGET_NS 2000
+#endif
+
+namespace parlay {
+
+// Learns the granularity of a parallel loop across calls. A call site can
+// own one explicitly and pass it to parallel_for, e.g.
+//
+//    static parlay::granularity_controller controller;
+//    parlay::parallel_for(0, frontier.size(), [&](size_t i) { ... }, controller);
+//
+// Safe to share between concurrent loops. Updates are not synchronized, so a
+// concurrent update can be lost, which only slows down learning.
+class granularity_controller {
+ public:
+  // True if the controller has an estimate, i.e., loops using it do not
+  // need to time a sequential prefix
+  [[nodiscard]] bool calibrated() const noexcept {
+    return ns_per_iteration.load(std::memory_order_relaxed) >= 0;
+  }
+
+  // The number of iterations that take about the target amount of time
+  [[nodiscard]] size_t granularity() const noexcept {
+    double estimate = ns_per_iteration.load(std::memory_order_relaxed);
+    if (estimate <= 0) return max_granularity;
+    double g = PARLAY_ADAPTIVE_GRANULARITY_TARGET_NS / estimate;
+    if (g >= static_cast<double>(max_granularity)) return max_granularity;
+    return (std::max)(size_t{1}, static_cast<size_t>(g));
+  }
+
+  // Record that the given number of iterations took the given time
+  void record(size_t iterations, uint64_t nanoseconds) noexcept {
+    if (iterations == 0) return;
+    double sample = static_cast<double>(nanoseconds) / static_cast<double>(iterations);
+    double estimate = ns_per_iteration.load(std::memory_order_relaxed);
+    if (estimate < 0) estimate = sample;
+    else estimate += (sample - estimate) / smoothing;
+    ns_per_iteration.store(estimate, std::memory_order_relaxed);
+  }
+
+  // Forget the estimate, so the next loop times a sequential prefix again
+  void reset() noexcept {
+    ns_per_iteration.store(-1, std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr size_t max_granularity = size_t{1} << 40;
+  static constexpr double smoothing = 8;
+
+  std::atomic<double> ns_per_iteration{-1};
+};
+
+namespace internal {
+
+// The controller used for loops over F when adaptive granularity is on
+template<typename F>
+granularity_controller& granularity_controller_for() {
+  static granularity_controller controller;
+  return controller;
+}
+
+}  // namespace internal
+}  // namespace parlay
+
+#endif  // PARLAY_INTERNAL_GRANULARITY_H_
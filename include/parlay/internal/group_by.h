@@ -8,6 +8,7 @@
 #include <utility>
 
 #include "../monoid.h"
+#include "../nested_sequence.h"
 #include "../range.h"
 #include "../sequence.h"
 #include "../slice.h"
@@ -346,6 +347,39 @@ auto group_by_index(R&& A, Integer_t num_buckets) {
     return r;
   }
 }
+
+// Like group_by_index, but returns the groups as a nested_sequence, i.e.,
+// in one flat sequence of values with the offsets of the groups, so that
+// there is no allocation per group. Within a group, the values keep their
+// order from A.
+template <typename Integer_t, typename R>
+auto nested_group_by_index(R&& A, Integer_t num_buckets) {
+  static_assert(is_random_access_range_v<R>);
+  static_assert(is_pair_v<range_value_type_t<R>>);
+  static_assert(std::is_integral_v<Integer_t>);
+  using V = std::tuple_element_t<1, range_value_type_t<R>>;
+  size_t n = A.size();
+  size_t m = static_cast<size_t>(num_buckets);
+
+  if (n == 0) return nested_sequence<V>(sequence<size_t>(m + 1), sequence<V>());
+
+  // With few buckets, a counting sort of the values produces the offsets directly
+  if (n > m * m) {
+    auto keys = internal::delayed_map(A, [] (auto const &kv) { return std::get<0>(kv); });
+    auto vals = internal::delayed_map(A, [] (auto const &kv) { return std::get<1>(kv); });
+    auto [values, offsets] = internal::count_sort(make_slice(vals), keys, m);
+    return nested_sequence<V>(std::move(offsets), std::move(values));
+  }
+  else {
+    auto [sorted, counts] = internal::integer_sort_with_counts(make_slice(A), internal::get_key, m);
+    auto offsets = sequence<size_t>::from_function(m + 1, [&, &counts = counts] (size_t i) -> size_t {
+      return (i == m) ? 0 : counts[i]; });
+    internal::scan_inplace(make_slice(offsets), plus<size_t>());
+    auto values = internal::map(make_slice(sorted), [] (auto& kv) {
+      return std::move(internal::get_val(kv)); });
+    return nested_sequence<V>(std::move(offsets), std::move(values));
+  }
+}
 			  
 
 #if defined(__clang__)
@@ -0,0 +1,185 @@
+#ifndef PARLAY_INTERNAL_GROWABLE_DEQUE_H_
+#define PARLAY_INTERNAL_GROWABLE_DEQUE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace parlay {
+namespace internal {
+
+// Deque from Chase and Lev (SPAA, 2005), whose circular buffer doubles in
+// size when it fills up, so deep recursion can not overflow it, with thieves
+// that take half of the jobs at once, up to max_steal, as in Hendler and
+// Shavit (PODC, 2002).
+//
+// Supports:
+//
+// push_bottom:     Only the owning thread may call this
+// pop_bottom:      Only the owning thread may call this
+// pop_top:         Non-owning threads may call this
+// pop_top_batch:   Non-owning threads may call this
+//
+// Indices grow without bound (modulo 2^32) and are mapped onto the buffer.
+// The top index is kept together with a tag, as in the Deque of Arora,
+// Blumofe, and Plaxton. A thief that takes k jobs advances the top by k
+// with a single CAS. Since k is at most half of the jobs that it saw, and
+// at most max_steal, the owner only has to synchronize with thieves when
+// it pops one of the last max_steal jobs, which it does by incrementing
+// the tag, so that any thief that read the top before it fails.
+//
+// Buffers that are replaced by a larger one are kept until the deque is
+// destroyed, since thieves may still be reading them. Their total size is
+// less than that of the current buffer.
+template <typename Job>
+class growable_deque {
+  using qidx = uint32_t;
+  using tag_t = uint32_t;
+
+  struct alignas(int64_t) age_t {
+    tag_t tag;
+    qidx top;
+  };
+
+  class buffer {
+   public:
+    explicit buffer(size_t capacity) : mask(capacity - 1), slots(new std::atomic<Job*>[capacity]) {}
+
+    [[nodiscard]] size_t capacity() const { return mask + 1; }
+    Job* get(qidx i) const { return slots[i & mask].load(std::memory_order_relaxed); }
+    void put(qidx i, Job* job) { slots[i & mask].store(job, std::memory_order_relaxed); }
+
+   private:
+    size_t mask;
+    std::unique_ptr<std::atomic<Job*>[]> slots;
+  };
+
+  static constexpr size_t initial_capacity = 256;
+
+ public:
+  // The most jobs that one call to pop_top_batch takes
+  static constexpr size_t max_steal = 16;
+
+  growable_deque() : bot(0), age(age_t{0, 0}) {
+    buffers.push_back(std::make_unique<buffer>(initial_capacity));
+    current.store(buffers.back().get(), std::memory_order_relaxed);
+  }
+
+  growable_deque(const growable_deque&) = delete;
+  growable_deque& operator=(const growable_deque&) = delete;
+
+  // Adds a new job to the bottom of the queue, growing it if it is full.
+  // Only the owning thread can push new items.
+  //
+  // Returns true if the queue was empty before this push
+  bool push_bottom(Job* job) {
+    auto local_bot = bot.load(std::memory_order_relaxed);
+    auto top = age.load(std::memory_order_acquire).top;
+    buffer* buf = current.load(std::memory_order_relaxed);
+    if (local_bot - top >= buf->capacity()) buf = grow(top, local_bot);
+    buf->put(local_bot, job);
+    bot.store(local_bot + 1, std::memory_order_seq_cst);
+    return local_bot == top;
+  }
+
+  // The queue never runs out of room
+  bool has_room(int) const { return true; }
+
+  // The number of jobs on the queue. Only meaningful when called by the
+  // owning thread, and may be stale by the time it returns.
+  size_t size() const {
+    auto local_bot = bot.load(std::memory_order_relaxed);
+    auto top = age.load(std::memory_order_relaxed).top;
+    auto n = static_cast<int32_t>(local_bot - top);
+    return n > 0 ? static_cast<size_t>(n) : 0;
+  }
+
+  // True if the queue may have jobs. Unlike size(), any thread can call it.
+  // A job pushed before a seq_cst fence that precedes the call is seen,
+  // unless it has been popped since.
+  bool maybe_nonempty() const {
+    auto top = age.load(std::memory_order_seq_cst).top;
+    auto local_bot = bot.load(std::memory_order_seq_cst);
+    return static_cast<int32_t>(local_bot - top) > 0;
+  }
+
+  // Take half of the jobs from the top of the queue, but at least one and
+  // at most max_jobs, and write them to out, oldest first. Threads other
+  // than the owner can use this function.
+  //
+  // Returns {number of jobs taken, empty}, where empty is true if the jobs
+  // taken were all of the jobs on the queue, or the queue was empty
+  std::pair<size_t, bool> pop_top_batch(Job** out, size_t max_jobs) {
+    auto old_age = age.load(std::memory_order_seq_cst);
+    auto local_bot = bot.load(std::memory_order_seq_cst);
+    auto n = static_cast<int32_t>(local_bot - old_age.top);
+    if (n <= 0) return {0, true};
+    size_t k = std::clamp<size_t>(static_cast<size_t>(n) / 2, 1, (std::min)(max_jobs, max_steal));
+    buffer* buf = current.load(std::memory_order_acquire);
+    for (size_t i = 0; i < k; i++) out[i] = buf->get(old_age.top + static_cast<qidx>(i));
+    bool empty = (k == static_cast<size_t>(n));
+    auto new_age = age_t{old_age.tag, old_age.top + static_cast<qidx>(k)};
+    if (age.compare_exchange_strong(old_age, new_age)) return {k, empty};
+    return {0, empty};
+  }
+
+  // Pop an item from the top of the queue.
+  //
+  // Returns {job, empty}, where empty is true if job was the
+  // only job on the queue, i.e., the queue is now empty
+  std::pair<Job*, bool> pop_top() {
+    Job* job = nullptr;
+    auto [count, empty] = pop_top_batch(&job, 1);
+    return {count > 0 ? job : nullptr, empty};
+  }
+
+  // Pop an item from the bottom of the queue. Only the owning
+  // thread can pop from this end.
+  Job* pop_bottom() {
+    auto local_bot = bot.load(std::memory_order_relaxed);
+    if (local_bot == age.load(std::memory_order_acquire).top) return nullptr;
+    local_bot--;
+    bot.store(local_bot, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    Job* job = current.load(std::memory_order_relaxed)->get(local_bot);
+    auto old_age = age.load(std::memory_order_seq_cst);
+    while (true) {
+      auto remaining = static_cast<int32_t>(local_bot - old_age.top);
+      if (remaining < 0) {
+        // Thieves took everything
+        bot.store(old_age.top, std::memory_order_seq_cst);
+        return nullptr;
+      }
+      if (remaining >= static_cast<int32_t>(max_steal)) return job;
+      // A thief that read the bottom before it was decremented could take
+      // this job. Change the tag so that such a thief fails.
+      if (age.compare_exchange_weak(old_age, age_t{old_age.tag + 1, old_age.top})) return job;
+    }
+  }
+
+ private:
+  std::atomic<qidx> bot;
+  std::atomic<age_t> age;
+  std::atomic<buffer*> current;
+  std::vector<std::unique_ptr<buffer>> buffers;   // only accessed by the owner
+
+  // Replace the buffer by one of twice the size that holds the same jobs
+  buffer* grow(qidx top, qidx local_bot) {
+    buffer* old_buf = current.load(std::memory_order_relaxed);
+    auto new_buf = std::make_unique<buffer>(2 * old_buf->capacity());
+    for (qidx i = top; i != local_bot; i++) new_buf->put(i, old_buf->get(i));
+    buffers.push_back(std::move(new_buf));
+    current.store(buffers.back().get(), std::memory_order_release);
+    return buffers.back().get();
+  }
+};
+
+}  // namespace internal
+}  // namespace parlay
+
+#endif  // PARLAY_INTERNAL_GROWABLE_DEQUE_H_
@@ -11,6 +11,7 @@
 #include <type_traits>
 #include <utility>
 
+#include "block_partition.h"
 #include "counting_sort.h"
 #include "sequence_ops.h"
 #include "uninitialized_sequence.h"
@@ -345,6 +346,60 @@ void integer_sort_inplace(slice<Iterator, Iterator> In,
 }
 
 
+// An unstable top down radix sort that sorts In in place, using extra
+// memory only for the buffers of the block partitions and for base cases
+// of up to PARLAY_INTEGER_SORT_BASE_CASE_SIZE elements, rather than a
+// temporary copy of the whole input. Each level partitions by the top
+// radix bits of the remaining key, with as many stripes as its share of
+// the parallelism, and then sorts the buckets in parallel.
+template <typename Iterator, typename Get_Key>
+void radix_sort_inplace_r(slice<Iterator, Iterator> In,
+                          Get_Key const &g,
+                          size_t key_bits,
+                          float parallelism = 1.0) {
+  using T = typename slice<Iterator, Iterator>::value_type;
+  size_t n = In.size();
+  if (key_bits == 0 || n <= 1) return;
+
+  if (n < PARLAY_INTEGER_SORT_BASE_CASE_SIZE) {
+    auto Tmp = uninitialized_sequence<T>(n);
+    seq_radix_sort_(In, make_slice(Tmp), g, key_bits, true);
+    return;
+  }
+
+  size_t bits = (std::min)(radix, key_bits);
+  size_t shift_bits = key_bits - bits;
+  size_t num_buckets = size_t{1} << bits;
+  size_t mask = num_buckets - 1;
+  size_t num_stripes = static_cast<size_t>(parallelism * static_cast<float>(num_workers()) + 0.5f);
+  auto get_bits = [&](const T& x) { return (static_cast<size_t>(g(x)) >> shift_bits) & mask; };
+  auto offsets = block_partition_inplace(In, num_buckets, get_bits, num_stripes);
+  if (shift_bits == 0) return;
+
+  parallel_for(0, num_buckets, [&](size_t i) {
+    size_t start = offsets[i];
+    size_t end = offsets[i + 1];
+    auto new_parallelism = (parallelism * static_cast<float>(end - start)) / static_cast<float>(n + 1);
+    radix_sort_inplace_r(In.cut(start, end), g, shift_bits, new_parallelism);
+  }, 1);
+}
+
+// Sort In in place by the keys given by g, without a temporary copy of
+// the input. Unlike integer_sort_inplace, the sort is not stable, and the
+// elements must be trivially relocatable. If bits is 0, a max is taken
+// over the keys to determine how many bits they have.
+template <typename Iterator, typename Get_Key>
+void radix_sort_inplace(slice<Iterator, Iterator> In,
+                        Get_Key const &g, size_t bits = 0) {
+  static_assert(is_trivially_relocatable_v<typename slice<Iterator, Iterator>::value_type>);
+  if (bits == 0) {
+    auto get_key = [&](size_t i) { return static_cast<size_t>(g(In[i])); };
+    auto keys = delayed_seq<size_t>(In.size(), get_key);
+    bits = log2_up(internal::reduce(make_slice(keys), maximum<size_t>()) + 1);
+  }
+  radix_sort_inplace_r(In, g, bits);
+}
+
 template <typename Iterator, typename Get_Key>
 auto integer_sort(slice<Iterator, Iterator> In,
                   Get_Key const &g,
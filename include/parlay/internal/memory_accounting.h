@@ -0,0 +1,264 @@
+// Accounting of the memory held by the allocators, to find out which
+// size classes, types and phases of a program drive its peak memory use.
+// Collection is compiled in only if PARLAY_MEMORY_ACCOUNTING is true.
+// Otherwise, the allocators keep no counters and reports are empty.
+
+#ifndef PARLAY_INTERNAL_MEMORY_ACCOUNTING_H_
+#define PARLAY_INTERNAL_MEMORY_ACCOUNTING_H_
+
+#include <cstddef>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#if __has_include(<cxxabi.h>)
+#include <cxxabi.h>
+#include <cstdlib>
+#endif
+
+#include "../thread_specific.h"
+
+// True if the allocators should count the bytes currently allocated and
+// the most ever allocated at once, for each size class of the pool
+// allocator and each type_allocator<T>, and for each parlay::memory_scope.
+// Each thread accumulates its changes locally and publishes them once they
+// reach memory_flush_threshold bytes, so a few plain stores per allocation
+// are the common cost, and peaks are exact up to that much per thread.
+//
+// Default: false
+#ifndef PARLAY_MEMORY_ACCOUNTING
+#define PARLAY_MEMORY_ACCOUNTING false
+#endif
+
+namespace parlay {
+
+struct memory_stats {
+  size_t current_bytes{0};     // bytes allocated and not yet freed
+  size_t peak_bytes{0};        // most bytes allocated at once
+  size_t allocated_bytes{0};   // bytes allocated in total
+  size_t allocations{0};       // number of allocations
+  size_t deallocations{0};     // number of deallocations
+};
+
+struct scope_memory_stats {
+  size_t entries{0};           // times a scope with the tag was entered
+  size_t allocated_bytes{0};   // bytes allocated in total while it was active
+  long long retained_bytes{0}; // bytes allocated while it was active and not freed by its end
+  size_t peak_bytes{0};        // most bytes allocated at once above the level at its start
+};
+
+// A snapshot of the memory accounted to each size class of the pool
+// allocator (which serves parlay::allocator, p_malloc, and sequences), to
+// each type_allocator<T>, and to each tag of parlay::memory_scope
+struct memory_report {
+  memory_stats total;                                                // all blocks of the pool allocator
+  std::vector<std::pair<size_t, memory_stats>> size_classes;         // by block size, 0 for larger blocks
+  std::vector<std::pair<std::string, memory_stats>> types;           // by type of the type_allocator
+  std::vector<std::pair<std::string, scope_memory_stats>> scopes;    // by tag
+
+  friend std::ostream& operator<<(std::ostream& os, const memory_report& report) {
+    auto columns = [&](const memory_stats& s) {
+      os.width(16); os << s.current_bytes;
+      os.width(16); os << s.peak_bytes;
+      os.width(18); os << s.allocated_bytes;
+      os.width(14); os << s.allocations;
+      os.width(14); os << s.deallocations;
+    };
+    os << "  size class   current bytes      peak bytes   allocated bytes   allocations deallocations\n";
+    for (const auto& [size, s] : report.size_classes) {
+      if (s.allocations == 0) continue;
+      os.width(12);
+      if (size == 0) os << "larger";
+      else os << size;
+      columns(s);
+      os << '\n';
+    }
+    os << "       total";
+    columns(report.total);
+    os << '\n';
+    if (!report.types.empty()) {
+      os << "\n               current bytes      peak bytes   allocated bytes   allocations deallocations  type\n";
+      for (const auto& [name, s] : report.types) {
+        os << "            ";
+        columns(s);
+        os << "  " << name << '\n';
+      }
+    }
+    if (!report.scopes.empty()) {
+      os << "\n     entries  retained bytes      peak bytes   allocated bytes  scope\n";
+      for (const auto& [tag, s] : report.scopes) {
+        os.width(12); os << s.entries;
+        os.width(16); os << s.retained_bytes;
+        os.width(16); os << s.peak_bytes;
+        os.width(18); os << s.allocated_bytes;
+        os << "  " << tag << '\n';
+      }
+    }
+    return os;
+  }
+};
+
+namespace internal {
+
+inline constexpr long long memory_flush_threshold = 1 << 16;
+
+// Byte counters for a fixed number of categories (e.g., size classes).
+// Each thread counts in its own slots, and adds its net change to the
+// shared count of a category when that reaches memory_flush_threshold
+// bytes, which is when the peak is updated.
+class memory_counters {
+
+  struct alignas(64) local_counts {
+    std::atomic<long long> unflushed{0};
+    std::atomic<size_t> allocated_bytes{0};
+    std::atomic<size_t> allocations{0};
+    std::atomic<size_t> deallocations{0};
+  };
+
+  struct alignas(64) shared_counts {
+    std::atomic<long long> current{0};
+    std::atomic<long long> peak{0};
+    std::atomic<long long> window_peak{0};
+  };
+
+  size_t n;
+  std::unique_ptr<shared_counts[]> shared;
+  ThreadSpecific<std::unique_ptr<local_counts[]>> locals;
+
+  // Only the owning thread updates its local counts
+  template<typename T>
+  static void add(std::atomic<T>& counter, T amount) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+  }
+
+  static void raise(std::atomic<long long>& peak, long long value) {
+    long long old = peak.load(std::memory_order_relaxed);
+    while (value > old && !peak.compare_exchange_weak(old, value, std::memory_order_relaxed)) { }
+  }
+
+  void add_bytes(size_t i, local_counts& local, long long bytes) {
+    long long unflushed = local.unflushed.load(std::memory_order_relaxed) + bytes;
+    if (unflushed >= memory_flush_threshold || unflushed <= -memory_flush_threshold) {
+      local.unflushed.store(0, std::memory_order_relaxed);
+      long long current = shared[i].current.fetch_add(unflushed, std::memory_order_relaxed) + unflushed;
+      raise(shared[i].peak, current);
+      raise(shared[i].window_peak, current);
+    } else {
+      local.unflushed.store(unflushed, std::memory_order_relaxed);
+    }
+  }
+
+ public:
+  explicit memory_counters(size_t n_)
+      : n(n_),
+        shared(std::make_unique<shared_counts[]>(n_)),
+        locals([n_]() { return std::make_unique<local_counts[]>(n_); }) {}
+
+  [[nodiscard]] size_t size() const { return n; }
+
+  void on_allocate(size_t i, size_t bytes) {
+    local_counts& local = (*locals)[i];
+    add(local.allocations, size_t{1});
+    add(local.allocated_bytes, bytes);
+    add_bytes(i, local, static_cast<long long>(bytes));
+  }
+
+  void on_deallocate(size_t i, size_t bytes) {
+    local_counts& local = (*locals)[i];
+    add(local.deallocations, size_t{1});
+    add_bytes(i, local, -static_cast<long long>(bytes));
+  }
+
+  // The bytes allocated and not freed, including the unpublished counts of
+  // every thread. Not synchronized with concurrent allocations.
+  [[nodiscard]] long long current(size_t i) {
+    long long result = shared[i].current.load(std::memory_order_relaxed);
+    locals.for_each([&](auto& local) { result += local[i].unflushed.load(std::memory_order_relaxed); });
+    return result;
+  }
+
+  [[nodiscard]] memory_stats snapshot(size_t i) {
+    memory_stats result;
+    long long current_bytes = current(i);
+    result.current_bytes = static_cast<size_t>((std::max)(current_bytes, 0LL));
+    result.peak_bytes = static_cast<size_t>((std::max)(shared[i].peak.load(std::memory_order_relaxed), current_bytes));
+    locals.for_each([&](auto& local) {
+      result.allocated_bytes += local[i].allocated_bytes.load(std::memory_order_relaxed);
+      result.allocations += local[i].allocations.load(std::memory_order_relaxed);
+      result.deallocations += local[i].deallocations.load(std::memory_order_relaxed);
+    });
+    return result;
+  }
+
+  // Start measuring the peak of category i from its current level, and
+  // return the state of the enclosing measurement, to pass to end_window
+  long long begin_window(size_t i) {
+    return shared[i].window_peak.exchange(current(i), std::memory_order_relaxed);
+  }
+
+  // Return the peak since the matching begin_window, and resume the
+  // enclosing measurement
+  long long end_window(size_t i, long long outer) {
+    long long peak = (std::max)(shared[i].window_peak.load(std::memory_order_relaxed), current(i));
+    shared[i].window_peak.store((std::max)(peak, outer), std::memory_order_relaxed);
+    return peak;
+  }
+
+  // Start the peaks over from the current levels
+  void reset_peaks() {
+    for (size_t i = 0; i < n; i++) {
+      shared[i].peak.store(current(i), std::memory_order_relaxed);
+    }
+  }
+};
+
+// The counters of every type_allocator<T>, and the totals of every tag of
+// memory_scope, by name
+struct memory_accounting_registry {
+  std::mutex mutex;
+  std::vector<std::pair<std::string, memory_counters*>> types;
+  std::map<std::string, scope_memory_stats> scopes;
+};
+
+inline memory_accounting_registry& get_memory_accounting_registry() {
+  static memory_accounting_registry registry;
+  return registry;
+}
+
+inline std::string demangled_type_name(const std::type_info& type) {
+#if __has_include(<cxxabi.h>)
+  int status = 0;
+  char* name = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+  if (status == 0 && name != nullptr) {
+    std::string result(name);
+    std::free(name);
+    return result;
+  }
+#endif
+  return type.name();
+}
+
+template<typename T>
+memory_counters& get_type_memory_counters() {
+  static memory_counters* counters = []() {
+    auto c = new memory_counters(1);     // Never freed, so that it outlives every type_allocator<T>
+    auto& registry = get_memory_accounting_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.types.emplace_back(demangled_type_name(typeid(T)), c);
+    return c;
+  }();
+  return *counters;
+}
+
+}  // namespace internal
+}  // namespace parlay
+
+#endif  // PARLAY_INTERNAL_MEMORY_ACCOUNTING_H_
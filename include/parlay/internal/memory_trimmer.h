@@ -0,0 +1,101 @@
+// A background thread that returns the free memory of the pool allocator
+// to the system once the program has stopped using it, so that a long
+// running program does not keep the memory of its peak forever.
+
+#ifndef PARLAY_INTERNAL_MEMORY_TRIMMER_H_
+#define PARLAY_INTERNAL_MEMORY_TRIMMER_H_
+
+#include <cstddef>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "pool_allocator.h"
+
+namespace parlay {
+
+// When to trim the pool allocator automatically. Every interval, a
+// background thread looks at the bytes in use, and trims the allocator once
+// they have not changed for idle_time, if it holds at least min_free_bytes
+// of free memory. After trimming, it waits for the bytes in use to change
+// before it trims again.
+struct memory_trim_policy {
+  std::chrono::milliseconds interval{0};       // 0 disables automatic trimming
+  std::chrono::milliseconds idle_time{1000};
+  size_t min_free_bytes{0};
+};
+
+namespace internal {
+
+class memory_trimmer {
+  using clock = std::chrono::steady_clock;
+
+  pool_allocator& pool;
+  std::mutex mutex;
+  std::condition_variable cv;
+  memory_trim_policy policy;
+  bool stopping{false};
+  std::thread thread;
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    size_t last_used = pool.stats().first;
+    auto last_active = clock::now();
+    bool trimmed = false;
+    while (!stopping) {
+      if (policy.interval.count() == 0) {
+        cv.wait(lock);
+        continue;
+      }
+      cv.wait_for(lock, policy.interval);
+      if (stopping || policy.interval.count() == 0) continue;
+
+      auto [used, free] = pool.stats();
+      auto now = clock::now();
+      if (used != last_used) {
+        last_used = used;
+        last_active = now;
+        trimmed = false;
+      }
+      if (!trimmed && now - last_active >= policy.idle_time && free > 0 && free >= policy.min_free_bytes) {
+        lock.unlock();
+        pool.trim();
+        lock.lock();
+        trimmed = true;
+      }
+    }
+  }
+
+ public:
+  explicit memory_trimmer(pool_allocator& pool_) : pool(pool_) {}
+
+  memory_trimmer(const memory_trimmer&) = delete;
+  memory_trimmer& operator=(const memory_trimmer&) = delete;
+
+  ~memory_trimmer() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    cv.notify_all();
+    if (thread.joinable()) thread.join();
+  }
+
+  // The background thread is started the first time that a policy with a
+  // nonzero interval is set, and sleeps while the interval is zero
+  void set_policy(const memory_trim_policy& policy_) {
+    std::lock_guard<std::mutex> lock(mutex);
+    policy = policy_;
+    if (policy.interval.count() > 0 && !thread.joinable()) {
+      thread = std::thread([this]() { run(); });
+    }
+    cv.notify_all();
+  }
+};
+
+}  // namespace internal
+}  // namespace parlay
+
+#endif  // PARLAY_INTERNAL_MEMORY_TRIMMER_H_
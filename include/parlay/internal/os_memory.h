@@ -0,0 +1,143 @@
+// Memory mapped directly from the operating system, for large blocks whose
+// backing the allocator wants to control, e.g., to use huge pages, which
+// cover 2MB of memory with a single TLB entry, so that random accesses to
+// large arrays miss the TLB much less often.
+//
+// With huge pages requested, os_allocate first tries pages from the pool
+// that the administrator reserved (MAP_HUGETLB), and otherwise maps normal
+// pages and asks for transparent huge pages (madvise(MADV_HUGEPAGE)), which
+// the kernel provides when it can. On systems without mmap, it falls back
+// to operator new.
+//
+// Memory can also be spread over the NUMA nodes of the machine, with pages
+// assigned to nodes round-robin (interleave_pages), which on Linux uses
+// mbind(MPOL_INTERLEAVE) without depending on libnuma.
+//
+// Memory freed with operator delete may stay in the heap of the C library,
+// which os_release_free_memory asks to give it back to the system.
+
+#ifndef PARLAY_INTERNAL_OS_MEMORY_H_
+#define PARLAY_INTERNAL_OS_MEMORY_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <new>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define PARLAY_HAS_MMAP
+#endif
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+
+namespace parlay {
+namespace internal {
+
+inline constexpr size_t huge_page_size = size_t{1} << 21;
+
+inline size_t os_page_size() {
+#if defined(PARLAY_HAS_MMAP)
+  static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return page_size;
+#else
+  return 4096;
+#endif
+}
+
+// The size of the mapping used for a block of n bytes
+inline size_t os_allocation_size(size_t n, bool huge) {
+  size_t granularity = huge ? huge_page_size : os_page_size();
+  return (n + granularity - 1) / granularity * granularity;
+}
+
+// Ask for the whole huge pages inside [p, p + n) to be transparent huge
+// pages. Does nothing if the system does not support them.
+inline void advise_huge_pages([[maybe_unused]] void* p, [[maybe_unused]] size_t n) {
+#if defined(PARLAY_HAS_MMAP) && defined(MADV_HUGEPAGE)
+  auto begin = (reinterpret_cast<uintptr_t>(p) + huge_page_size - 1) & ~(huge_page_size - 1);
+  auto end = (reinterpret_cast<uintptr_t>(p) + n) & ~(huge_page_size - 1);
+  if (begin < end) madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE);
+#endif
+}
+
+// Allocate n bytes of memory from the operating system, aligned to a huge
+// page boundary, and backed by huge pages if huge is true and the system
+// can provide them. Returns nullptr on failure.
+inline void* os_allocate(size_t n, bool huge) {
+  size_t size = os_allocation_size(n, huge);
+#if defined(PARLAY_HAS_MMAP)
+#if defined(MAP_HUGETLB)
+  if (huge) {
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED) return p;
+  }
+#endif
+  // Over-allocate so that the block can start on a huge page boundary,
+  // and unmap the excess on both sides
+  size_t padded = size + huge_page_size;
+  void* p = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) return nullptr;
+  auto start = reinterpret_cast<uintptr_t>(p);
+  auto aligned = (start + huge_page_size - 1) & ~(huge_page_size - 1);
+  if (aligned > start) munmap(p, aligned - start);
+  if (aligned + size < start + padded) munmap(reinterpret_cast<void*>(aligned + size), start + padded - aligned - size);
+  if (huge) advise_huge_pages(reinterpret_cast<void*>(aligned), size);
+  return reinterpret_cast<void*>(aligned);
+#else
+  return ::operator new(size, std::align_val_t{huge_page_size}, std::nothrow);
+#endif
+}
+
+// Free a block obtained from os_allocate(n, huge)
+inline void os_deallocate(void* p, [[maybe_unused]] size_t n, [[maybe_unused]] bool huge) {
+#if defined(PARLAY_HAS_MMAP)
+  munmap(p, os_allocation_size(n, huge));
+#else
+  ::operator delete(p, std::align_val_t{huge_page_size}, std::nothrow);
+#endif
+}
+
+// Ask the C library to return the free memory in its heap to the system.
+// Does nothing where this is not supported.
+inline void os_release_free_memory() {
+#if defined(__GLIBC__)
+  malloc_trim(0);
+#endif
+}
+
+// Place the pages of [p, p + n), which must not have been touched yet,
+// round-robin on the given NUMA nodes (numbered as by the OS). Returns
+// false if this is not supported or failed, in which case pages are placed
+// on the node of the thread that first touches them.
+inline bool interleave_pages([[maybe_unused]] void* p, [[maybe_unused]] size_t n,
+                             [[maybe_unused]] const std::vector<unsigned int>& nodes) {
+#if defined(__linux__) && defined(SYS_mbind)
+  if (nodes.empty()) return false;
+  constexpr size_t bits = 8 * sizeof(unsigned long);
+  unsigned int max_node = 0;
+  for (auto node : nodes) max_node = (std::max)(max_node, node);
+  std::vector<unsigned long> mask(max_node / bits + 1, 0);
+  for (auto node : nodes) mask[node / bits] |= 1UL << (node % bits);
+  auto begin = reinterpret_cast<uintptr_t>(p) & ~(os_page_size() - 1);
+  auto end = reinterpret_cast<uintptr_t>(p) + n;
+  return syscall(SYS_mbind, begin, end - begin, MPOL_INTERLEAVE, mask.data(), max_node + 2, 0) == 0;
+#else
+  return false;
+#endif
+}
+
+}  // namespace internal
+}  // namespace parlay
+
+#endif  // PARLAY_INTERNAL_OS_MEMORY_H_
@@ -16,15 +16,60 @@
 #include <vector>
 
 #include "../portability.h"
+#include "../thread_specific.h"
 #include "../utilities.h"
 
 #include "block_allocator.h"
+#include "memory_accounting.h"
+#include "os_memory.h"
 
 #include "concurrency/hazptr_stack.h"
 
 // IWYU pragma: no_include <array>
 
+// The most bytes that the pool allocator keeps in reserve in freed large
+// blocks, which are reused by later allocations of the same size class.
+// Large blocks that are freed while the reserve is full are returned to the
+// system. Can be changed at runtime with parlay::set_large_allocation_cache_limit.
+//
+// Default: 0 (no limit)
+#ifndef PARLAY_LARGE_ALLOCATION_CACHE_LIMIT
+#define PARLAY_LARGE_ALLOCATION_CACHE_LIMIT 0
+#endif
+
+
+// True if the pool allocator should back blocks of 2MB and more with huge
+// pages where the system provides them, which makes random access to large
+// sequences cheaper. To use huge pages for some sequences only, give them
+// a parlay::huge_page_allocator instead.
+//
+// Default: false
+#ifndef PARLAY_HUGE_PAGES
+#define PARLAY_HUGE_PAGES false
+#endif
+
 namespace parlay {
+
+// Counters of the reuse of large blocks by the pool allocator
+struct large_allocation_statistics {
+  size_t hits{0};             // large allocations served by a cached block
+  size_t misses{0};           // large allocations that went to the system allocator
+  size_t evictions{0};        // freed large blocks returned to the system because the cache was full
+  size_t cached_bytes{0};     // bytes currently held in cached blocks
+
+  // The fraction of large allocations served by a cached block
+  [[nodiscard]] double hit_rate() const {
+    size_t total = hits + misses;
+    return total > 0 ? static_cast<double>(hits) / static_cast<double>(total) : 0;
+  }
+};
+
+// Counters of the free memory that the pool allocator returned to the system
+struct memory_trim_statistics {
+  size_t trims{0};            // times that the allocator was trimmed
+  size_t released_bytes{0};   // bytes returned to the system in total
+};
+
 namespace internal {
 
 // ****************************************
@@ -36,9 +81,14 @@ namespace internal {
 // Sizes must be at least 8, and must increase.
 // For pools of small blocks (below large_threshold) each thread keeps a
 // thread local list of elements from each pool using the block_allocator.
-// For large blocks there is only one pool shared by all threads. For
-// blocks larger than the maximum pool size, allocation and deallocation
-// is performed directly by operator new.
+// For large blocks there is one pool shared by all threads, in front of
+// which each thread caches one freed block of each of the smallest large
+// sizes (up to thread_cache_max_size), so that a thread that repeatedly
+// allocates and frees the same temporary gets back memory that is still in
+// its cache. The total size of the cached large blocks is bounded by a
+// limit (PARLAY_LARGE_ALLOCATION_CACHE_LIMIT). For blocks larger than the
+// maximum pool size, allocation and deallocation is performed directly by
+// operator new. Free memory is kept until trim() returns it to the system.
 struct pool_allocator {
 
   // Maximum alignment guaranteed by the allocator
@@ -46,51 +96,138 @@ struct pool_allocator {
   
  private:
   static inline constexpr size_t large_threshold = (1 << 18);
+  static inline constexpr size_t thread_cache_max_size = (1 << 23);
+  static inline constexpr size_t thread_cache_slots = 8;
+
+  // One cached block for each of the first few large buckets. Atomic so
+  // that trim() can take blocks from the caches of other threads.
+  struct alignas(128) thread_cache {
+    std::atomic<void*> blocks[thread_cache_slots]{};
+  };
 
   size_t num_buckets;
   size_t num_small;
   size_t max_small;
   size_t max_size;
+  size_t num_thread_cached;
   std::atomic<size_t> large_allocated{0};
   std::atomic<size_t> large_used{0};
+  std::atomic<size_t> large_cached{0};
+  std::atomic<size_t> large_cache_limit{PARLAY_LARGE_ALLOCATION_CACHE_LIMIT};
+  std::atomic<size_t> large_hits{0};
+  std::atomic<size_t> large_misses{0};
+  std::atomic<size_t> large_evictions{0};
+  std::atomic<size_t> trims{0};
+  std::atomic<size_t> trimmed_bytes{0};
 
   std::unique_ptr<size_t[]> sizes;
   std::unique_ptr<internal::hazptr_stack<void*>[]> large_buckets;
   unique_array<block_allocator> small_allocators;
+  ThreadSpecific<thread_cache> thread_caches;
+
+#if PARLAY_MEMORY_ACCOUNTING
+  // One category per pool size, and one for blocks larger than the largest pool
+  memory_counters size_class_counters;
+  memory_counters total_counters{1};
+
+  void account(size_t n, bool allocated) {
+    size_t i = 0;
+    while (i < num_buckets && n > sizes[i]) i++;
+    size_t bytes = (i < num_buckets) ? sizes[i] : round_to_alignment(n);
+    if (allocated) {
+      size_class_counters.on_allocate(i, bytes);
+      total_counters.on_allocate(0, bytes);
+    } else {
+      size_class_counters.on_deallocate(i, bytes);
+      total_counters.on_deallocate(0, bytes);
+    }
+  }
+#endif
 
-  void* allocate_large(size_t n) {
+  // Alloc size must be a multiple of the alignment
+  static size_t round_to_alignment(size_t n) {
+    return (n + max_alignment - 1) / max_alignment * max_alignment;
+  }
 
-    size_t bucket = num_small;
-    size_t alloc_size;
+  static void* allocate_block(size_t size) {
+#if PARLAY_HUGE_PAGES
+    if (size >= huge_page_size) {
+      void* p = os_allocate(size, true);
+      if (p == nullptr) throw std::bad_alloc();
+      return p;
+    }
+#endif
+    return ::operator new(size, std::align_val_t{max_alignment});
+  }
+
+  static void free_block(void* ptr, [[maybe_unused]] size_t size) {
+#if PARLAY_HUGE_PAGES
+    if (size >= huge_page_size) return os_deallocate(ptr, size, true);
+#endif
+    ::operator delete(ptr, std::align_val_t{max_alignment});
+  }
+
+  // Account for a block of the given size entering the cache. Returns
+  // false, and changes nothing, if that would exceed the limit.
+  bool reserve_cache_space(size_t size) {
+    size_t limit = large_cache_limit.load(std::memory_order_relaxed);
+    size_t cached = large_cached.fetch_add(size, std::memory_order_relaxed) + size;
+    if (limit != 0 && cached > limit) {
+      large_cached.fetch_sub(size, std::memory_order_relaxed);
+      return false;
+    }
+    return true;
+  }
+
+  void* allocate_large(size_t n) {
     large_used += n;
+    size_t alloc_size;
 
     if (n <= max_size) {
+      size_t bucket = num_small;
       while (n > sizes[bucket]) bucket++;
-      std::optional<void*> r = large_buckets[bucket-num_small].pop();
-      if (r) return *r;
+      void* r = nullptr;
+      if (bucket - num_small < num_thread_cached) {
+        r = thread_caches->blocks[bucket - num_small].exchange(nullptr, std::memory_order_acquire);
+      }
+      if (r == nullptr) {
+        std::optional<void*> shared = large_buckets[bucket-num_small].pop();
+        if (shared) r = *shared;
+      }
+      if (r != nullptr) {
+        large_cached.fetch_sub(sizes[bucket], std::memory_order_relaxed);
+        large_hits.fetch_add(1, std::memory_order_relaxed);
+        return r;
+      }
       alloc_size = sizes[bucket];
     } else alloc_size = n;
 
-    // Alloc size must be a multiple of the alignment
-    // Round up to the next multiple.
-    if (alloc_size % max_alignment != 0) {
-      alloc_size += (max_alignment - (alloc_size % max_alignment));
-    }
-
-    void* a = ::operator new(alloc_size, std::align_val_t{max_alignment});
+    alloc_size = round_to_alignment(alloc_size);
+    void* a = allocate_block(alloc_size);
 
-    large_allocated += n;
+    large_misses.fetch_add(1, std::memory_order_relaxed);
+    large_allocated += alloc_size;
     return a;
   }
 
   void deallocate_large(void* ptr, size_t n) {
     large_used -= n;
     if (n > max_size) {
-      ::operator delete(ptr, std::align_val_t{max_alignment});
-      large_allocated -= n;
+      free_block(ptr, round_to_alignment(n));
+      large_allocated -= round_to_alignment(n);
+      return;
+    }
+    size_t bucket = num_small;
+    while (n > sizes[bucket]) bucket++;
+    if (!reserve_cache_space(sizes[bucket])) {
+      free_block(ptr, round_to_alignment(sizes[bucket]));
+      large_allocated -= round_to_alignment(sizes[bucket]);
+      large_evictions.fetch_add(1, std::memory_order_relaxed);
+    } else if (bucket - num_small < num_thread_cached &&
+               thread_caches->blocks[bucket - num_small].load(std::memory_order_relaxed) == nullptr) {
+      // Only the owning thread stores into its cache, so the slot stays empty
+      thread_caches->blocks[bucket - num_small].store(ptr, std::memory_order_release);
     } else {
-      size_t bucket = num_small;
-      while (n > sizes[bucket]) bucket++;
       large_buckets[bucket-num_small].push(ptr);
     }
   }
@@ -107,7 +244,11 @@ struct pool_allocator {
 
   explicit pool_allocator(const std::vector<size_t>& sizes_) :
       num_buckets(sizes_.size()),
-      sizes(std::make_unique<size_t[]>(num_buckets)) {
+      sizes(std::make_unique<size_t[]>(num_buckets))
+#if PARLAY_MEMORY_ACCOUNTING
+      , size_class_counters(num_buckets + 1)
+#endif
+  {
 
     std::copy(std::begin(sizes_), std::end(sizes_), sizes.get());
     max_size = sizes[num_buckets-1];
@@ -115,6 +256,10 @@ struct pool_allocator {
     while (num_small < num_buckets && sizes[num_small] < large_threshold)
       num_small++;
     max_small = (num_small > 0) ? sizes[num_small - 1] : 0;
+    num_thread_cached = 0;
+    while (num_thread_cached < thread_cache_slots && num_small + num_thread_cached < num_buckets &&
+           sizes[num_small + num_thread_cached] <= thread_cache_max_size)
+      num_thread_cached++;
 
     large_buckets = std::make_unique<internal::hazptr_stack<void*>[]>(num_buckets-num_small);
     small_allocators = make_unique_array<internal::block_allocator>(num_small, [&](size_t i) {
@@ -133,13 +278,23 @@ struct pool_allocator {
   }
 
   void* allocate(size_t n) {
-    if (n > max_small) return allocate_large(n);
-    size_t bucket = 0;
-    while (n > sizes[bucket]) bucket++;
-    return small_allocators[bucket].alloc();
+    void* result;
+    if (n > max_small) result = allocate_large(n);
+    else {
+      size_t bucket = 0;
+      while (n > sizes[bucket]) bucket++;
+      result = small_allocators[bucket].alloc();
+    }
+#if PARLAY_MEMORY_ACCOUNTING
+    account(n, true);
+#endif
+    return result;
   }
 
   void deallocate(void* ptr, size_t n) {
+#if PARLAY_MEMORY_ACCOUNTING
+    account(n, false);
+#endif
     if (n > max_small) deallocate_large(ptr, n);
     else {
       size_t bucket = 0;
@@ -182,15 +337,92 @@ struct pool_allocator {
     return {total_u, total_a-total_u};
   }
 
-  void clear() {
+  // The limit on the total size of cached large blocks, where 0 means no
+  // limit. Lowering the limit does not release blocks that are already cached.
+  void set_large_cache_limit(size_t bytes) {
+    large_cache_limit.store(bytes, std::memory_order_relaxed);
+  }
+
+  large_allocation_statistics large_stats() const {
+    large_allocation_statistics result;
+    result.hits = large_hits.load(std::memory_order_relaxed);
+    result.misses = large_misses.load(std::memory_order_relaxed);
+    result.evictions = large_evictions.load(std::memory_order_relaxed);
+    result.cached_bytes = large_cached.load(std::memory_order_relaxed);
+    return result;
+  }
+
+#if PARLAY_MEMORY_ACCOUNTING
+  // The bytes allocated by size class and in total, in blocks of the pool size
+  void memory_accounting(memory_report& report) {
+    report.total = total_counters.snapshot(0);
+    report.size_classes.clear();
+    for (size_t i = 0; i <= num_buckets; i++) {
+      report.size_classes.emplace_back(i < num_buckets ? sizes[i] : 0, size_class_counters.snapshot(i));
+    }
+  }
+
+  // Start the peaks over from the current levels
+  void reset_memory_peaks() {
+    size_class_counters.reset_peaks();
+    total_counters.reset_peaks();
+  }
+
+  // The counters of the total, to measure the peak of a memory_scope
+  memory_counters& total_memory_counters() { return total_counters; }
+#endif
+
+  // Release all cached large blocks, and return the number of bytes released
+  size_t release_large_blocks() {
+    size_t released = 0;
+    auto release = [&](void* ptr, size_t size) {
+      large_allocated -= round_to_alignment(size);
+      large_cached -= size;
+      free_block(ptr, round_to_alignment(size));
+      released += round_to_alignment(size);
+    };
+    thread_caches.for_each([&](thread_cache& cache) {
+      for (size_t i = 0; i < num_thread_cached; i++) {
+        void* ptr = cache.blocks[i].exchange(nullptr, std::memory_order_acquire);
+        if (ptr != nullptr) release(ptr, sizes[num_small + i]);
+      }
+    });
     for (size_t i = num_small; i < num_buckets; i++) {
       std::optional<void*> r = large_buckets[i-num_small].pop();
       while (r) {
-        large_allocated -= sizes[i];
-        ::operator delete(*r, std::align_val_t{max_alignment});
+        release(*r, sizes[i]);
         r = large_buckets[i-num_small].pop();
       }
     }
+    return released;
+  }
+
+  // Return free memory to the system: every cached large block, and the
+  // buffers of small blocks that are entirely free (see block_allocator::trim).
+  // Returns the number of bytes released. Safe to call concurrently with
+  // allocations and deallocations, but not with clear.
+  size_t trim() {
+    size_t released = release_large_blocks();
+    for (size_t i = 0; i < num_small; i++) {
+      released += small_allocators[i].trim();
+    }
+    if (released > 0) os_release_free_memory();
+    trims.fetch_add(1, std::memory_order_relaxed);
+    trimmed_bytes.fetch_add(released, std::memory_order_relaxed);
+    return released;
+  }
+
+  memory_trim_statistics trim_stats() const {
+    memory_trim_statistics result;
+    result.trims = trims.load(std::memory_order_relaxed);
+    result.released_bytes = trimmed_bytes.load(std::memory_order_relaxed);
+    return result;
+  }
+
+  // Release all cached large blocks. Not safe to call concurrently with
+  // allocations and deallocations.
+  void clear() {
+    release_large_blocks();
   }
 };
 
@@ -12,6 +12,7 @@
 #include "sequence_ops.h"
 #include "counting_sort.h"
 #include "sequence_ops.h"
+#include "sorting_network.h"
 
 #include "../utilities.h"
 
@@ -146,16 +147,26 @@ std::tuple<Iterator, Iterator, bool> split3(Iterator A, size_t n, const BinPred&
   return std::make_tuple(L, M, pivots_equal);
 }
 
+// Keys that a sorting network can sort are partitioned down to the largest
+// size that it handles, and then sorted by it instead of insertion sort
 template <class Iterator, class BinPred>
 void quicksort_serial(Iterator A, size_t n, const BinPred& f) {
-  while (!base_case(A, n)) {
+  using value_type = typename std::iterator_traits<Iterator>::value_type;
+  constexpr bool use_network = is_simd_sortable_v<value_type, BinPred>;
+  auto is_base_case = [&](size_t n) {
+    if constexpr (use_network) return n <= simd_sort_max_size<value_type>();
+    else return base_case(A, n);
+  };
+
+  while (!is_base_case(n)) {
     auto [L, M, mid_eq] = split3(A, n, f);
     if (!mid_eq) quicksort_serial(L+1, M - L-1, f);
     quicksort_serial(M, A + n - M, f);
     n = L - A;
   }
 
-  insertion_sort(A, n, f);
+  if constexpr (use_network) simd_sort(A, n, f);
+  else insertion_sort(A, n, f);
 }
 
 template <class Iterator, class BinPred>
@@ -11,10 +11,13 @@
 #include <cassert>
 #include <cstdio>
 
+#include <algorithm>
 #include <iterator>
 #include <limits>
 #include <type_traits>
+#include <utility>
 
+#include "block_partition.h"
 #include "bucket_sort.h"
 #include "quicksort.h"
 #include "sequence_ops.h"
@@ -199,6 +202,119 @@ void sample_sort_inplace_(slice<InIterator, InIterator> In,
   }
 }
 
+// Classifies elements into the buckets of a set of sorted splitters by
+// descending an implicit binary search tree, so that an element is
+// classified with log(k) comparisons and no branches that depend on the
+// result of a comparison.
+//
+// An element x goes to bucket b if splitters[b-1] <= x < splitters[b]. If
+// some of the splitters are equal, every splitter also gets an equality
+// bucket of the elements equivalent to it, which then need no sorting. In
+// that case x goes to bucket 2b-1 if it is equivalent to splitters[b-1],
+// and to bucket 2b otherwise.
+template <typename T, typename Compare>
+struct splitter_tree_classifier {
+  size_t log_k;
+  size_t k;
+  bool equal_buckets;
+  sequence<T> tree;       // tree[1..k) in breadth first order
+  sequence<T> splitters;  // the k-1 splitters in sorted order
+  const Compare& less;
+
+  // sorted_splitters must hold 2^log_k - 1 sorted elements
+  splitter_tree_classifier(sequence<T> sorted_splitters, size_t log_k_, bool equal_buckets_, const Compare& less_)
+      : log_k(log_k_), k(size_t{1} << log_k_), equal_buckets(equal_buckets_),
+        splitters(std::move(sorted_splitters)), less(less_) {
+    assert(splitters.size() == k - 1);
+    // Node i at depth d is the middle splitter of its subtree
+    tree = sequence<T>::from_function(k, [&](size_t i) -> T {
+      if (i == 0) return splitters[0];
+      size_t d = log2_up(i + 1) - 1;
+      size_t j = i - (size_t{1} << d);
+      return splitters[(2 * j + 1) * (size_t{1} << (log_k - d - 1)) - 1];
+    });
+  }
+
+  size_t num_buckets() const { return equal_buckets ? 2 * k - 1 : k; }
+
+  bool is_equality_bucket(size_t bucket) const { return equal_buckets && (bucket % 2 == 1); }
+
+  size_t operator()(const T& x) const {
+    size_t b = 1;
+    for (size_t l = 0; l < log_k; l++) {
+      b = 2 * b + static_cast<size_t>(!less(x, tree[b]));
+    }
+    b -= k;
+    if (!equal_buckets) return b;
+    return 2 * b - static_cast<size_t>(b > 0 && !less(splitters[b - 1], x));
+  }
+};
+
+// In place super scalar sample sort, after
+//
+// In-place Parallel Super Scalar Samplesort (IPS4o).
+// Michael Axtmann, Sascha Witt, Daniel Ferizovic and Peter Sanders.
+// European Symposium on Algorithms (ESA), 2017
+//
+// Each level picks up to 255 splitters from a sample, partitions the input
+// around them with block_partition_inplace, and then sorts the buckets in
+// parallel. Unlike sample_sort_inplace_, which moves every element through
+// a temporary copy of the input, the extra memory is only that of the
+// partition buffers, a few blocks per bucket per stripe, and a copy of the
+// splitters. The elements must be trivially relocatable and copyable, since
+// the splitters are copies. The sort is not stable.
+template <typename Iterator, typename Compare>
+void block_sample_sort_inplace_(slice<Iterator, Iterator> A,
+                                const Compare& less,
+                                float parallelism = 1.0) {
+  using value_type = typename slice<Iterator, Iterator>::value_type;
+  size_t n = A.size();
+
+  if (n < QUICKSORT_THRESHOLD) {
+    seq_sort_inplace(A, less, false);
+    return;
+  }
+
+  // Aim for buckets of around a quarter of the base case size at the
+  // last level, with at least 4 buckets so that every bucket is strictly
+  // smaller than the input, and at most 256 so the buffers stay in cache
+  size_t log_k = (std::min)(size_t{8}, (std::max)(size_t{2}, log2_up(4 * n / QUICKSORT_THRESHOLD)));
+  size_t k = size_t{1} << log_k;
+  size_t over_sample = (std::max)(size_t{1}, static_cast<size_t>(0.2 * log2_up(n)));
+
+  // Take evenly spaced splitters from a sorted sample
+  size_t sample_size = over_sample * k;
+  auto sample = sequence<value_type>::from_function(sample_size, [&](size_t i) -> value_type {
+    return A[hash64(i + n) % n];
+  });
+  quicksort(sample.begin(), sample_size, less);
+  auto splitters = sequence<value_type>::from_function(k - 1, [&](size_t i) -> value_type {
+    return sample[(i + 1) * over_sample - 1];
+  });
+
+  // With many equal keys some splitters are equal. Use each distinct one
+  // once, pad with copies of the largest, and give each an equality bucket,
+  // so that runs of equal keys are not sorted any further.
+  auto distinct_end = std::unique(splitters.begin(), splitters.end(), [&](const auto& a, const auto& b) {
+    return !less(a, b);
+  });
+  bool equal_buckets = distinct_end != splitters.end();
+  for (auto it = distinct_end; it != splitters.end(); ++it) *it = *(distinct_end - 1);
+
+  auto classify = splitter_tree_classifier<value_type, Compare>(std::move(splitters), log_k, equal_buckets, less);
+  size_t num_buckets = classify.num_buckets();
+  size_t num_stripes = static_cast<size_t>(parallelism * static_cast<float>(num_workers()) + 0.5f);
+  auto offsets = block_partition_inplace(A, num_buckets, classify, num_stripes);
+
+  parallel_for(0, num_buckets, [&](size_t i) {
+    size_t start = offsets[i];
+    size_t end = offsets[i + 1];
+    if (classify.is_equality_bucket(i)) return;
+    auto new_parallelism = (parallelism * static_cast<float>(end - start)) / static_cast<float>(n + 1);
+    block_sample_sort_inplace_(A.cut(start, end), less, new_parallelism);
+  }, 1);
+}
+
 // Copying version of sample sort. This one makes copies of the input
 // elements when sorting them into the output. Roughly (\sqrt{n})
 // additional copies are also made to copy the pivots. This one can
@@ -288,6 +404,13 @@ auto sample_sort(slice<Iterator, Iterator> A,
   return R;
 }
 
+template <class Iterator, typename Compare>
+void block_sample_sort_inplace(slice<Iterator, Iterator> A,
+                               const Compare& less) {
+  static_assert(is_trivially_relocatable_v<typename slice<Iterator, Iterator>::value_type>);
+  block_sample_sort_inplace_(A, less);
+}
+
 template <class Iterator, typename Compare>
 void sample_sort_inplace(slice<Iterator, Iterator> A,
                          const Compare& less) {
@@ -0,0 +1,148 @@
+// Statistics collected by the scheduler about the work done by each
+// worker, to diagnose load imbalance and poor scaling. Collection is
+// compiled in only if PARLAY_SCHEDULER_STATS is true. Otherwise, the
+// scheduler keeps no counters and snapshots are empty.
+
+#ifndef PARLAY_INTERNAL_SCHEDULER_STATS_H_
+#define PARLAY_INTERNAL_SCHEDULER_STATS_H_
+
+#include <cstddef>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+// True if the scheduler should count the jobs run by each worker, its
+// steal attempts, the time it spends looking for work and sleeping, and
+// the deepest that its deque has been. Costs a few relaxed atomic updates
+// per job, and clock reads whenever a worker runs out of local work.
+//
+// Default: false
+#ifndef PARLAY_SCHEDULER_STATS
+#define PARLAY_SCHEDULER_STATS false
+#endif
+
+namespace parlay {
+
+struct worker_stats {
+  size_t jobs_executed{0};                     // jobs run, whether spawned locally or stolen
+  size_t steals{0};                            // successful steal attempts
+  size_t failed_steals{0};                     // steal attempts that found no job
+  size_t sleeps{0};                            // times the worker went to sleep
+  std::chrono::nanoseconds steal_time{0};      // time spent looking for jobs to steal
+  std::chrono::nanoseconds sleep_time{0};      // time spent asleep waiting for work
+  size_t deque_high_water{0};                  // most jobs on the worker's deque at once
+
+  worker_stats& operator+=(const worker_stats& other) {
+    jobs_executed += other.jobs_executed;
+    steals += other.steals;
+    failed_steals += other.failed_steals;
+    sleeps += other.sleeps;
+    steal_time += other.steal_time;
+    sleep_time += other.sleep_time;
+    deque_high_water = (std::max)(deque_high_water, other.deque_high_water);
+    return *this;
+  }
+};
+
+// A snapshot of the statistics of every worker of a scheduler
+struct scheduler_statistics {
+  std::vector<worker_stats> workers;
+
+  // Counts summed over all workers, and the largest high-water mark
+  [[nodiscard]] worker_stats total() const {
+    worker_stats result;
+    for (const auto& w : workers) result += w;
+    return result;
+  }
+
+  // The ratio between the most jobs run by one worker and the average.
+  // 1 means perfectly balanced, num_workers means one worker did everything.
+  [[nodiscard]] double job_imbalance() const {
+    if (workers.empty()) return 1;
+    size_t most = 0;
+    for (const auto& w : workers) most = (std::max)(most, w.jobs_executed);
+    double average = static_cast<double>(total().jobs_executed) / static_cast<double>(workers.size());
+    return average > 0 ? static_cast<double>(most) / average : 1;
+  }
+
+  friend std::ostream& operator<<(std::ostream& os, const scheduler_statistics& stats) {
+    auto ms = [](std::chrono::nanoseconds t) { return std::chrono::duration<double, std::milli>(t).count(); };
+    os << "worker        jobs      steals      failed  sleeps  steal ms  sleep ms  max deque\n";
+    auto row = [&](auto&& name, const worker_stats& w) {
+      os.width(6); os << name;
+      os.width(12); os << w.jobs_executed;
+      os.width(12); os << w.steals;
+      os.width(12); os << w.failed_steals;
+      os.width(8); os << w.sleeps;
+      os.width(10); os << ms(w.steal_time);
+      os.width(10); os << ms(w.sleep_time);
+      os.width(11); os << w.deque_high_water;
+      os << '\n';
+    };
+    for (size_t i = 0; i < stats.workers.size(); i++) row(i, stats.workers[i]);
+    row("total", stats.total());
+    os << "job imbalance (max / mean): " << stats.job_imbalance() << '\n';
+    return os;
+  }
+};
+
+namespace internal {
+
+// The counters of one worker. Only the worker updates them, so updates do
+// not need read-modify-write atomics, but snapshots may read them at any time.
+struct alignas(128) worker_counters {
+  std::atomic<size_t> jobs_executed{0};
+  std::atomic<size_t> steals{0};
+  std::atomic<size_t> failed_steals{0};
+  std::atomic<size_t> sleeps{0};
+  std::atomic<long long> steal_ns{0};
+  std::atomic<long long> sleep_ns{0};
+  std::atomic<size_t> deque_high_water{0};
+
+  template<typename T>
+  static void add(std::atomic<T>& counter, T amount) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+  }
+
+  static long long since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  void update_high_water(size_t depth) {
+    if (depth > deque_high_water.load(std::memory_order_relaxed)) {
+      deque_high_water.store(depth, std::memory_order_relaxed);
+    }
+  }
+
+  [[nodiscard]] worker_stats snapshot() const {
+    worker_stats result;
+    result.jobs_executed = jobs_executed.load(std::memory_order_relaxed);
+    result.steals = steals.load(std::memory_order_relaxed);
+    result.failed_steals = failed_steals.load(std::memory_order_relaxed);
+    result.sleeps = sleeps.load(std::memory_order_relaxed);
+    result.steal_time = std::chrono::nanoseconds(steal_ns.load(std::memory_order_relaxed));
+    result.sleep_time = std::chrono::nanoseconds(sleep_ns.load(std::memory_order_relaxed));
+    result.deque_high_water = deque_high_water.load(std::memory_order_relaxed);
+    return result;
+  }
+
+  // Not synchronized with the worker, so counts from jobs that are
+  // running concurrently with the reset may survive it
+  void reset() {
+    jobs_executed.store(0, std::memory_order_relaxed);
+    steals.store(0, std::memory_order_relaxed);
+    failed_steals.store(0, std::memory_order_relaxed);
+    sleeps.store(0, std::memory_order_relaxed);
+    steal_ns.store(0, std::memory_order_relaxed);
+    sleep_ns.store(0, std::memory_order_relaxed);
+    deque_high_water.store(0, std::memory_order_relaxed);
+  }
+};
+
+}  // namespace internal
+}  // namespace parlay
+
+#endif  // PARLAY_INTERNAL_SCHEDULER_STATS_H_
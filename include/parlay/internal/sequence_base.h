@@ -13,7 +13,7 @@
 #include <cstdint>
 #include <cstring>
 
-#include <array>
+#include <algorithm>
 #include <memory>
 #include <new>
 #include <type_traits>
@@ -37,11 +37,17 @@ namespace sequence_internal {
 //  T = element type of the sequence
 //  Allocator = An allocator for elements of type T
 //  EnableSSO = True to enable small-size optimization
-template<typename T, typename Allocator, bool EnableSSO>
+//  InlineCapacity = The number of elements to make room for inline, or 0
+//                   for as many as fit in the 15 bytes of a long sequence
+template<typename T, typename Allocator, bool EnableSSO, size_t InlineCapacity = 0>
 struct alignas(uint64_t) sequence_base {
 
-  // Only use SSO for trivial types
-  constexpr static bool use_sso = EnableSSO && std::is_trivial<T>::value;
+  // By default, only use SSO for trivial types. With an explicit inline
+  // capacity, use it for any trivially relocatable type, since inline
+  // elements are moved by copying their bytes
+  constexpr static bool use_sso = EnableSSO &&
+      ((InlineCapacity == 0) ? std::is_trivial<T>::value
+                             : (is_trivially_relocatable_v<T> && alignof(T) <= alignof(uint64_t)));
 
   // The maximum length of a sequence is 2^48 - 1.
   constexpr static uint64_t _max_size = (1LL << 48LL) - 1LL;
@@ -81,7 +87,7 @@ struct alignas(uint64_t) sequence_base {
   //     }
   //     // Short sequence
   //     struct {
-  //       unsigned char    buffer[15]
+  //       unsigned char    buffer[15]       // or more, for an InlineCapacity
   //     }
   //   }
   //
@@ -94,21 +100,23 @@ struct alignas(uint64_t) sequence_base {
   // to a heap-allocated buffer prepended with its capacity, and a
   // 48-bit integer that stores the current size of the sequence.
   // Alternatively, it contains a short sequence, which is 15 bytes
-  // of inline memory used to store elements of type T.
+  // of inline memory used to store elements of type T, or enough for
+  // InlineCapacity elements (at most 127) if that is larger.
   //
   // If SSO is enabled, the 1 bit flag indicates whether the sequence
   // is long (1) or short (0). If the sequence is short, its size is
   // stored in the 7-bit size variable. This means that a zero-initialized
   // object represents a valid empty sequence. Short size optimization is
-  // only enabled for trivial types, which means that a sequence is trivially
-  // movable (i.e. you can move it by copying its raw bytes and zeroing
-  // out the old one).
+  // only enabled for trivially relocatable types, which means that a sequence
+  // is trivially movable (i.e. you can move it by copying its raw bytes and
+  // zeroing out the old one).
   //
   // On compilers / platforms that support the GNU C packed struct
   // extension, all of this fits into 16 bytes. This means that sequences
   // can be compare-exchanged (CAS'ed) on platforms that support a
   // 16-byte CAS operation. On other compilers / platforms, a sequence
-  // might be 24 bytes if EnableSSO is true.
+  // might be 24 bytes if EnableSSO is true. A larger InlineCapacity
+  // makes the sequence as large as needed, in multiples of 8 bytes.
   //
   struct storage_impl : public T_allocator_type {
 
@@ -117,7 +125,7 @@ struct alignas(uint64_t) sequence_base {
 
     // Copy constructor
     storage_impl(const storage_impl& other) : T_allocator_type(other) {
-      if (other.is_small()) {
+      if (other.is_small() && std::is_trivially_copyable_v<value_type>) {
         std::memcpy(static_cast<void*>(std::addressof(_data)), static_cast<const void*>(std::addressof(other._data)),
                     sizeof(_data));
       } else {
@@ -152,8 +160,8 @@ struct alignas(uint64_t) sequence_base {
     raw_allocator_type get_raw_allocator() const { return raw_allocator_type(get_T_allocator()); }
 
     // Swap a sequence backend with another. Since small sequences
-    // must contain trivial types, a sequence can always be swapped
-    // by swapping raw bytes.
+    // must contain trivially relocatable types, a sequence can always
+    // be swapped by swapping raw bytes.
     void swap(storage_impl& other) {
       // Swap raw bytes. Every linter complains about this so
       // we need a lot of warning suppressions, unfortunately
@@ -173,8 +181,8 @@ struct alignas(uint64_t) sequence_base {
     // Assumes that this sequence is empty. Callers
     // should call clear() before calling this function.
     void move_from(storage_impl&& other) {
-      // Since small sequences contain trivial types, moving
-      // them just means copying their raw bytes, and zeroing
+      // Since small sequences contain trivially relocatable types,
+      // moving them just means copying their raw bytes, and zeroing
       // out the old sequence. For large sequences, this will
       // copy their buffer pointer and size.
 
@@ -196,10 +204,8 @@ struct alignas(uint64_t) sequence_base {
     // Destroy all elements, free the buffer (if any)
     // and set the sequence to the empty sequence
     void clear() {
-      // Small sequences can only hold trivial
-      // types, so no destruction is necessary
+      destroy_all();
       if (!is_small()) {
-        destroy_all();
         auto alloc = get_raw_allocator();
         _data.long_mode.buffer.free_buffer(alloc);
       }
@@ -211,8 +217,6 @@ struct alignas(uint64_t) sequence_base {
     // of the sequence. This is intended for use after
     // the contents of the sequence are relocated
     void clear_without_destruction() {
-      // Small sequences can only hold trivial
-      // types, so no destruction is necessary
       if (!is_small()) {
         auto alloc = get_raw_allocator();
         _data.long_mode.buffer.free_buffer(alloc);
@@ -369,8 +373,16 @@ struct alignas(uint64_t) sequence_base {
       const value_type* data() const { return buffer.data(); }
     } PARLAY_PACKED;
 
+    // The bytes available for a short-size-optimized sequence. Room for
+    // InlineCapacity elements is rounded up so that the whole sequence,
+    // including the byte of the flag and size, is a multiple of 8 bytes
+    constexpr static size_t default_short_bytes = sizeof(capacitated_buffer) + sizeof(uint64_t) - 1;
+    constexpr static size_t short_bytes = (std::max)(default_short_bytes,
+        (InlineCapacity * sizeof(value_type) + sizeof(uint64_t)) / sizeof(uint64_t) * sizeof(uint64_t) - 1);
+
     // The maximum capacity of a short-size-optimized sequence
-    constexpr static size_t short_capacity = (sizeof(capacitated_buffer) + sizeof(uint64_t) - 1) / sizeof(value_type);
+    constexpr static size_t short_capacity = (std::min)(short_bytes / sizeof(value_type), size_t{127});
+    static_assert(InlineCapacity <= 127, "The inline capacity of a sequence can be at most 127");
 
 #if defined(__GNUC__) && !defined(__clang__)
 #pragma GCC diagnostic pop
@@ -379,13 +391,13 @@ struct alignas(uint64_t) sequence_base {
     // A short-size-optimized sequence. Elements are stored
     // inline in the data structure.
     struct short_seq {
-      std::array<value_type, short_capacity> elements;
+      std::byte elements[short_bytes];
 
       short_seq() = delete;
       ~short_seq() = delete;
 
-      value_type* data() { return elements.data(); }
-      const value_type* data() const { return elements.data(); }
+      value_type* data() { return reinterpret_cast<value_type*>(elements); }
+      const value_type* data() const { return reinterpret_cast<const value_type*>(elements); }
     } PARLAY_PACKED;
 
 
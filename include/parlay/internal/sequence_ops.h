@@ -9,6 +9,7 @@
 #include <type_traits>
 #include <utility>
 
+#include "../arena.h"
 #include "../delayed_sequence.h"
 #include "../monoid.h"
 #include "../parallel.h"
@@ -20,6 +21,11 @@
 namespace parlay {
 namespace internal {
 
+// Temporaries that are freed before the primitive that allocates them
+// returns. They come from the current arena, if there is one.
+template <typename T>
+using temporary_sequence = sequence<T, arena_allocator<T>>;
+
 // Return a sequence consisting of the elements
 //   f(0), f(1), ... f(n)
 template<typename UnaryOp>
@@ -198,7 +204,7 @@ auto reduce(Seq const &A, Monoid&& m, flags fl = no_flag) {
   if (l == 1 || (fl & fl_sequential)) {
     return reduce_serial(A, m);
   }
-  auto sums = sequence<T>::uninitialized(l);
+  auto sums = temporary_sequence<T>::uninitialized(l);
   sliced_for(n, block_size, [&](size_t i, size_t s, size_t e) {
     assign_uninitialized(sums[i], reduce_serial(make_slice(A).cut(s, e), m));
   });
@@ -244,7 +250,7 @@ auto scan_(In_Seq const &In, Out_Range Out, Monoid&& m, flags fl, bool out_unini
   size_t l = num_blocks(n, _block_size);
   if (l <= 2 || fl & fl_sequential)
     return scan_serial(In, Out, m, m.identity, fl, out_uninitialized);
-  auto sums = sequence<T>::uninitialized(l);
+  auto sums = temporary_sequence<T>::uninitialized(l);
   sliced_for(n, _block_size, [&](size_t i, size_t s, size_t e) {
     assign_uninitialized(sums[i], reduce_serial(make_slice(In).cut(s, e), m));
   });
@@ -319,7 +325,7 @@ auto pack(In_Seq const &In, Bool_Seq const &Fl, flags fl = no_flag)
   size_t n = In.size();
   size_t l = num_blocks(n, _block_size);
   if (l == 1 || fl & fl_sequential) return pack_serial(In, Fl);
-  auto sums = sequence<size_t>::uninitialized(l);
+  auto sums = temporary_sequence<size_t>::uninitialized(l);
   sliced_for(n, _block_size, [&](size_t i, size_t s, size_t e) {
     assign_uninitialized(sums[i], sum_bools_serial(make_slice(Fl).cut(s, e)));
   });
@@ -340,7 +346,7 @@ size_t pack_out(In_Seq const &In, Bool_Seq const &Fl, /* uninitialized */ Out_Se
   if (l <= 1 || fl & fl_sequential) {
     return pack_serial_at(In, make_slice(Fl).cut(0, In.size()), Out);
   }
-  sequence<size_t> Sums(l);
+  temporary_sequence<size_t> Sums(l);
   sliced_for(n, _block_size, [&](size_t i, size_t s, size_t e) {
     Sums[i] = sum_bools_serial(make_slice(Fl).cut(s, e));
   });
@@ -360,8 +366,8 @@ auto filter_map(In_Seq const &In, F&& f, G&& g) {
   size_t l = num_blocks(n, _block_size);
   auto in_mapped = delayed_seq<outT>(n, [&] (size_t i) { return g(In[i]); });
 
-  sequence<size_t> Sums(l);
-  sequence<bool> Fl(n);
+  temporary_sequence<size_t> Sums(l);
+  temporary_sequence<bool> Fl(n);
   sliced_for(n, _block_size, [&](size_t i, size_t s, size_t e) {
     size_t r = 0;
     for (size_t j = s; j < e; j++) r += (Fl[j] = f(In[j]));
@@ -392,8 +398,8 @@ template <typename In_Seq, typename Out_Seq, typename F>
 size_t filter_out(In_Seq const &In, /* uninitialized */ Out_Seq Out, F&& f) {
   size_t n = In.size();
   size_t l = num_blocks(n, _block_size);
-  sequence<size_t> Sums(l);
-  sequence<bool> Fl(n);
+  temporary_sequence<size_t> Sums(l);
+  temporary_sequence<bool> Fl(n);
   sliced_for(n, _block_size, [&](size_t i, size_t s, size_t e) {
     size_t r = 0;
     for (size_t j = s; j < e; j++) r += (Fl[j] = f(In[j]));
@@ -424,8 +430,8 @@ std::pair<size_t, size_t> split_three(slice<InIterator, InIterator> In,
                                       Char_Seq const &Fl, flags fl = no_flag) {
   size_t n = In.size();
   size_t l = num_blocks(n, _block_size);
-  sequence<size_t> Sums0(l);
-  sequence<size_t> Sums1(l);
+  temporary_sequence<size_t> Sums0(l);
+  temporary_sequence<size_t> Sums1(l);
   sliced_for(n, _block_size, [&](size_t i, size_t s, size_t e) {
     size_t c0 = 0;
     size_t c1 = 0;
@@ -461,7 +467,7 @@ auto split_two(In_Seq const &In, Bool_Seq const &Fl, flags fl = no_flag)
   using T = typename In_Seq::value_type;
   size_t n = In.size();
   size_t l = num_blocks(n, _block_size);
-  sequence<size_t> Sums(l);
+  temporary_sequence<size_t> Sums(l);
   sliced_for(n, _block_size, [&](size_t i, size_t s, size_t e) {
     size_t c = 0;
     for (size_t j = s; j < e; j++) c += (Fl[j] == false);
@@ -0,0 +1,377 @@
+// Vectorized bitonic sorting networks for the base cases of the comparison
+// sorts. A sort of a few dozen arithmetic keys by std::less or std::greater
+// spends most of its time in insertion sort, whose branches on the result
+// of each comparison are mispredicted about half the time. A sorting
+// network makes a fixed sequence of compare-exchanges instead, each of
+// which is a vector min and max over whole registers of keys.
+//
+// The networks are used when the code is compiled for AVX-512 (__AVX512F__)
+// or AVX2 (__AVX2__), for the element types that simd_sort_key supports:
+// 32 and 64-bit integers, floats, doubles, and std::pairs of 32-bit
+// integers, which sort as a single 64-bit key. Defining PARLAY_NO_SIMD_SORT
+// turns them off.
+//
+// Every key is first mapped to a signed integer with the same order by a
+// bijection, so the vectors only ever need signed integer min and max, and
+// the output is always a permutation of the input, even for floats that
+// do not compare as a strict weak order, such as NaNs.
+
+#ifndef PARLAY_INTERNAL_SORTING_NETWORK_H_
+#define PARLAY_INTERNAL_SORTING_NETWORK_H_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#if !defined(PARLAY_NO_SIMD_SORT) && defined(__AVX512F__)
+#define PARLAY_SIMD_SORT_AVX512
+#include <immintrin.h>
+#elif !defined(PARLAY_NO_SIMD_SORT) && defined(__AVX2__)
+#define PARLAY_SIMD_SORT_AVX2
+#include <immintrin.h>
+#endif
+
+#include "../portability.h"
+
+namespace parlay {
+namespace internal {
+
+// ------------------------------ Key mapping ------------------------------
+
+// Maps elements of type T to signed integers of the same order, and back.
+template <typename T, typename = void>
+struct simd_sort_key {
+  static constexpr bool supported = false;
+};
+
+template <typename T>
+struct simd_sort_key<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+                                         (sizeof(T) == 4 || sizeof(T) == 8)>> {
+  static constexpr bool supported = true;
+  using key_type = std::conditional_t<sizeof(T) == 4, int32_t, int64_t>;
+  using unsigned_key_type = std::make_unsigned_t<key_type>;
+  static constexpr unsigned_key_type bias = std::is_signed_v<T> ? 0 : unsigned_key_type{1} << (8 * sizeof(T) - 1);
+
+  static key_type to_key(T x) { return static_cast<key_type>(static_cast<unsigned_key_type>(x) ^ bias); }
+  static T from_key(key_type k) { return static_cast<T>(static_cast<unsigned_key_type>(k) ^ bias); }
+};
+
+// Negative floats order in reverse of their bits as integers, so all but
+// the sign bit of them are flipped
+template <typename T>
+struct simd_sort_key<T, std::enable_if_t<std::is_floating_point_v<T> && std::numeric_limits<T>::is_iec559 &&
+                                         (sizeof(T) == 4 || sizeof(T) == 8)>> {
+  static constexpr bool supported = true;
+  using key_type = std::conditional_t<sizeof(T) == 4, int32_t, int64_t>;
+  using unsigned_key_type = std::make_unsigned_t<key_type>;
+  static constexpr size_t sign_shift = 8 * sizeof(T) - 1;
+
+  static unsigned_key_type flip(unsigned_key_type u) { return u ^ ((unsigned_key_type{0} - (u >> sign_shift)) >> 1); }
+
+  static key_type to_key(T x) {
+    unsigned_key_type u;
+    std::memcpy(&u, &x, sizeof(T));
+    return static_cast<key_type>(flip(u));
+  }
+  static T from_key(key_type k) {
+    unsigned_key_type u = flip(static_cast<unsigned_key_type>(k));
+    T x;
+    std::memcpy(&x, &u, sizeof(T));
+    return x;
+  }
+};
+
+// Pairs of 32-bit integers compare lexicographically, which is the order of
+// the 64-bit integer with the first in the high half and the second in the
+// low half, each biased to an unsigned order
+template <typename A, typename B>
+struct simd_sort_key<std::pair<A, B>, std::enable_if_t<simd_sort_key<A>::supported && simd_sort_key<B>::supported &&
+                                                       std::is_integral_v<A> && std::is_integral_v<B> &&
+                                                       sizeof(A) == 4 && sizeof(B) == 4>> {
+  static constexpr bool supported = true;
+  using key_type = int64_t;
+
+  static key_type to_key(const std::pair<A, B>& x) {
+    uint64_t high = static_cast<uint32_t>(simd_sort_key<A>::to_key(x.first)) ^ 0x80000000u;
+    uint64_t low = static_cast<uint32_t>(simd_sort_key<B>::to_key(x.second)) ^ 0x80000000u;
+    return static_cast<key_type>(((high << 32) | low) ^ (uint64_t{1} << 63));
+  }
+  static std::pair<A, B> from_key(key_type k) {
+    uint64_t u = static_cast<uint64_t>(k) ^ (uint64_t{1} << 63);
+    auto first = simd_sort_key<A>::from_key(static_cast<int32_t>(static_cast<uint32_t>(u >> 32) ^ 0x80000000u));
+    auto second = simd_sort_key<B>::from_key(static_cast<int32_t>(static_cast<uint32_t>(u) ^ 0x80000000u));
+    return {first, second};
+  }
+};
+
+// 1 if Compare sorts T in increasing order, -1 if in decreasing order,
+// and 0 if it is not known to be either
+template <typename T, typename Compare>
+constexpr int simd_sort_direction() {
+  using C = std::decay_t<Compare>;
+  if constexpr (std::is_same_v<C, std::less<>> || std::is_same_v<C, std::less<T>>) return 1;
+  else if constexpr (std::is_same_v<C, std::greater<>> || std::is_same_v<C, std::greater<T>>) return -1;
+  else return 0;
+}
+
+// ----------------------------- Vector types ------------------------------
+
+// Each vector type provides, for W lanes of a signed integer scalar type,
+// unaligned loads and stores, lanewise min and max, swap_lanes<S>, which
+// swaps every lane j with lane j ^ S, and blend<Mask>, which takes lane j
+// from its second argument if bit j of Mask is set and else from its first.
+
+#if defined(PARLAY_SIMD_SORT_AVX512)
+
+// Some versions of GCC warn about the undefined vectors that the AVX-512
+// intrinsics pass as the ignored sources of their unmasked forms
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+struct simd_sort_vec_i32 {
+  using scalar = int32_t;
+  using vec = __m512i;
+  static constexpr size_t W = 16;
+
+  static vec load(const scalar* p) { return _mm512_loadu_si512(p); }
+  static void store(scalar* p, vec v) { _mm512_storeu_si512(p, v); }
+  static vec min(vec a, vec b) { return _mm512_min_epi32(a, b); }
+  static vec max(vec a, vec b) { return _mm512_max_epi32(a, b); }
+
+  template <size_t S>
+  static vec swap_lanes(vec v) {
+    if constexpr (S == 1) return _mm512_shuffle_epi32(v, _MM_PERM_CDAB);
+    else if constexpr (S == 2) return _mm512_shuffle_epi32(v, _MM_PERM_BADC);
+    else if constexpr (S == 4) return _mm512_shuffle_i32x4(v, v, 0xB1);
+    else return _mm512_shuffle_i32x4(v, v, 0x4E);
+  }
+
+  template <unsigned Mask>
+  static vec blend(vec a, vec b) { return _mm512_mask_blend_epi32(static_cast<__mmask16>(Mask), a, b); }
+};
+
+struct simd_sort_vec_i64 {
+  using scalar = int64_t;
+  using vec = __m512i;
+  static constexpr size_t W = 8;
+
+  static vec load(const scalar* p) { return _mm512_loadu_si512(p); }
+  static void store(scalar* p, vec v) { _mm512_storeu_si512(p, v); }
+  static vec min(vec a, vec b) { return _mm512_min_epi64(a, b); }
+  static vec max(vec a, vec b) { return _mm512_max_epi64(a, b); }
+
+  template <size_t S>
+  static vec swap_lanes(vec v) {
+    if constexpr (S == 1) return _mm512_shuffle_epi32(v, _MM_PERM_BADC);
+    else if constexpr (S == 2) return _mm512_shuffle_i64x2(v, v, 0xB1);
+    else return _mm512_shuffle_i64x2(v, v, 0x4E);
+  }
+
+  template <unsigned Mask>
+  static vec blend(vec a, vec b) { return _mm512_mask_blend_epi64(static_cast<__mmask8>(Mask), a, b); }
+};
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#elif defined(PARLAY_SIMD_SORT_AVX2)
+
+struct simd_sort_vec_i32 {
+  using scalar = int32_t;
+  using vec = __m256i;
+  static constexpr size_t W = 8;
+
+  static vec load(const scalar* p) { return _mm256_loadu_si256(reinterpret_cast<const vec*>(p)); }
+  static void store(scalar* p, vec v) { _mm256_storeu_si256(reinterpret_cast<vec*>(p), v); }
+  static vec min(vec a, vec b) { return _mm256_min_epi32(a, b); }
+  static vec max(vec a, vec b) { return _mm256_max_epi32(a, b); }
+
+  template <size_t S>
+  static vec swap_lanes(vec v) {
+    if constexpr (S == 1) return _mm256_shuffle_epi32(v, 0xB1);
+    else if constexpr (S == 2) return _mm256_shuffle_epi32(v, 0x4E);
+    else return _mm256_permute2x128_si256(v, v, 0x01);
+  }
+
+  template <unsigned Mask>
+  static vec blend(vec a, vec b) { return _mm256_blend_epi32(a, b, Mask); }
+};
+
+// AVX2 has no 64-bit min and max, so they are a compare and a blend
+struct simd_sort_vec_i64 {
+  using scalar = int64_t;
+  using vec = __m256i;
+  static constexpr size_t W = 4;
+
+  static vec load(const scalar* p) { return _mm256_loadu_si256(reinterpret_cast<const vec*>(p)); }
+  static void store(scalar* p, vec v) { _mm256_storeu_si256(reinterpret_cast<vec*>(p), v); }
+  static vec min(vec a, vec b) { return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b)); }
+  static vec max(vec a, vec b) { return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b)); }
+
+  template <size_t S>
+  static vec swap_lanes(vec v) {
+    if constexpr (S == 1) return _mm256_shuffle_epi32(v, 0x4E);
+    else return _mm256_permute2x128_si256(v, v, 0x01);
+  }
+
+  // Each 64-bit lane is two lanes of the 32-bit blend
+  static constexpr unsigned widen(unsigned mask) {
+    unsigned wide = 0;
+    for (size_t j = 0; j < W; j++) {
+      if (mask & (1u << j)) wide |= 3u << (2 * j);
+    }
+    return wide;
+  }
+
+  template <unsigned Mask>
+  static vec blend(vec a, vec b) { return _mm256_blend_epi32(a, b, widen(Mask)); }
+};
+
+#endif
+
+// -------------------------------- Network --------------------------------
+
+#if defined(PARLAY_SIMD_SORT_AVX512) || defined(PARLAY_SIMD_SORT_AVX2)
+
+template <typename F, size_t... I>
+PARLAY_INLINE void simd_sort_static_for(F&& f, std::index_sequence<I...>) {
+  (f(std::integral_constant<size_t, I>{}), ...);
+}
+
+// A bitonic sorting network over R vectors of V, which sorts their R * W
+// keys in row major order. Merge stage (K, S) compare-exchanges every key
+// j with key j ^ S, keeping the smaller one first if j & K is zero, and
+// last otherwise. Stages with S >= W compare whole vectors, and the others
+// compare the lanes of each vector with lanes of the same vector.
+template <typename V, size_t R>
+struct bitonic_sorting_network {
+  using vec = typename V::vec;
+  static constexpr size_t W = V::W;
+  static constexpr size_t M = R * W;
+
+  // The lanes of vector i that keep the larger key in stage (K, S)
+  static constexpr unsigned max_lanes(size_t i, size_t K, size_t S) {
+    unsigned mask = 0;
+    for (size_t j = 0; j < W; j++) {
+      bool upper = (j & S) != 0;
+      bool descending = ((i * W + j) & K) != 0;
+      if (upper != descending) mask |= 1u << j;
+    }
+    return mask;
+  }
+
+  template <size_t K, size_t S>
+  PARLAY_INLINE static void stage(vec* v) {
+    simd_sort_static_for([&](auto I) {
+      constexpr size_t i = decltype(I)::value;
+      if constexpr (S >= W) {
+        constexpr size_t d = S / W;
+        if constexpr ((i & d) == 0) {
+          vec lo = V::min(v[i], v[i + d]);
+          vec hi = V::max(v[i], v[i + d]);
+          constexpr bool descending = ((i * W) & K) != 0;
+          v[i] = descending ? hi : lo;
+          v[i + d] = descending ? lo : hi;
+        }
+      }
+      else {
+        vec partner = V::template swap_lanes<S>(v[i]);
+        v[i] = V::template blend<max_lanes(i, K, S)>(V::min(v[i], partner), V::max(v[i], partner));
+      }
+    }, std::make_index_sequence<R>{});
+  }
+
+  template <size_t K, size_t S>
+  PARLAY_INLINE static void merge(vec* v) {
+    stage<K, S>(v);
+    if constexpr (S > 1) merge<K, S / 2>(v);
+  }
+
+  template <size_t K = 2>
+  PARLAY_INLINE static void sort(vec* v) {
+    merge<K, K / 2>(v);
+    if constexpr (K < M) sort<2 * K>(v);
+  }
+
+  static void sort(typename V::scalar* keys) {
+    vec v[R];
+    for (size_t i = 0; i < R; i++) v[i] = V::load(keys + i * W);
+    sort(v);
+    for (size_t i = 0; i < R; i++) V::store(keys + i * W, v[i]);
+  }
+};
+
+template <typename Key>
+using simd_sort_vec = std::conditional_t<sizeof(Key) == 4, simd_sort_vec_i32, simd_sort_vec_i64>;
+
+// Up to 16 vectors are sorted at once. Larger networks do more compare-
+// exchanges per key, but still beat partitioning down to fewer keys.
+template <typename T>
+constexpr size_t simd_sort_max_size() {
+  return 16 * simd_sort_vec<typename simd_sort_key<T>::key_type>::W;
+}
+
+template <typename T, typename Compare>
+constexpr bool is_simd_sortable_v = simd_sort_key<T>::supported && simd_sort_direction<T, Compare>() != 0;
+
+// Sorts the n <= simd_sort_max_size<T>() elements of A by the sorting
+// network of the fewest vectors that hold them, padding the rest of the
+// vectors with the largest key
+template <typename Iterator, typename Compare>
+void simd_sort(Iterator A, size_t n, const Compare&) {
+  using T = typename std::iterator_traits<Iterator>::value_type;
+  using Keys = simd_sort_key<T>;
+  using key_type = typename Keys::key_type;
+  using V = simd_sort_vec<key_type>;
+  constexpr size_t W = V::W;
+  assert(n <= simd_sort_max_size<T>());
+  if (n <= 1) return;
+
+  alignas(64) key_type keys[16 * W];
+  for (size_t i = 0; i < n; i++) keys[i] = Keys::to_key(A[i]);
+  size_t num_vecs = (n <= W) ? 1 : (n <= 2 * W) ? 2 : (n <= 4 * W) ? 4 : (n <= 8 * W) ? 8 : 16;
+  for (size_t i = n; i < num_vecs * W; i++) keys[i] = (std::numeric_limits<key_type>::max)();
+
+  switch (num_vecs) {
+    case 1: bitonic_sorting_network<V, 1>::sort(keys); break;
+    case 2: bitonic_sorting_network<V, 2>::sort(keys); break;
+    case 4: bitonic_sorting_network<V, 4>::sort(keys); break;
+    case 8: bitonic_sorting_network<V, 8>::sort(keys); break;
+    default: bitonic_sorting_network<V, 16>::sort(keys); break;
+  }
+
+  if constexpr (simd_sort_direction<T, Compare>() > 0) {
+    for (size_t i = 0; i < n; i++) A[i] = Keys::from_key(keys[i]);
+  }
+  else {
+    for (size_t i = 0; i < n; i++) A[i] = Keys::from_key(keys[n - 1 - i]);
+  }
+}
+
+#else
+
+template <typename T, typename Compare>
+constexpr bool is_simd_sortable_v = false;
+
+template <typename T>
+constexpr size_t simd_sort_max_size() { return 0; }
+
+template <typename Iterator, typename Compare>
+void simd_sort(Iterator, size_t, const Compare&) {}
+
+#endif  // PARLAY_SIMD_SORT_AVX512 || PARLAY_SIMD_SORT_AVX2
+
+}  // namespace internal
+}  // namespace parlay
+
+#endif  // PARLAY_INTERNAL_SORTING_NETWORK_H_
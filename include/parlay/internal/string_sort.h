@@ -0,0 +1,223 @@
+// A parallel sort for strings, i.e. random-access ranges of one-byte
+// characters, that also computes the longest common prefix (LCP) of each
+// pair of adjacent strings in the sorted order.
+//
+// Comparison sorts compare strings from their first character every time,
+// which repeats a lot of work when many strings share long prefixes, as
+// URLs and log lines do. This sort instead inspects each character of a
+// string at most a few times, so its work is roughly the total length of
+// the distinguishing prefixes, plus n log(n) for the sequential base cases.
+//
+// Large groups of strings are sorted by a parallel most significant digit
+// radix sort, one character at a time, which skips whole runs of characters
+// that every string in the group shares. Small groups are sorted by
+// multikey quicksort:
+//
+// Fast algorithms for sorting and searching strings.
+// Jon L. Bentley and Robert Sedgewick.
+// ACM-SIAM Symposium on Discrete Algorithms (SODA), 1997
+//
+// Only indices of the strings are sorted, so strings are never moved or
+// copied. Characters compare as unsigned, as they do for std::string, and
+// a string sorts before any longer string that it is a prefix of.
+
+#ifndef PARLAY_INTERNAL_STRING_SORT_H_
+#define PARLAY_INTERNAL_STRING_SORT_H_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+#include "counting_sort.h"
+#include "sequence_ops.h"
+
+#include "../delayed_sequence.h"
+#include "../monoid.h"
+#include "../parallel.h"
+#include "../sequence.h"
+#include "../slice.h"
+#include "../utilities.h"
+
+namespace parlay {
+namespace internal {
+
+// Groups smaller than this are sorted sequentially by multikey quicksort
+#ifdef DEBUG
+constexpr size_t STRING_SORT_BASE_CASE_SIZE = 64;
+#else
+constexpr size_t STRING_SORT_BASE_CASE_SIZE = 1 << 14;
+#endif
+
+// Groups smaller than this are sorted by insertion sort
+constexpr size_t STRING_SORT_INSERTION_SIZE = 16;
+
+// The longest run of shared characters that is looked for at once
+constexpr size_t STRING_SORT_PREFIX_WINDOW = 256;
+
+template <typename Iterator>
+struct string_sorter {
+  using index = size_t;
+
+  slice<Iterator, Iterator> S;
+  index* idx;    // the indices of the strings, permuted into sorted order
+  size_t* lcp;   // lcp[i] is the LCP of the strings at idx[i-1] and idx[i]
+
+  // Character d of string s, as 1 plus its unsigned value, or 0 past the end
+  unsigned int key(index s, size_t d) const {
+    const auto& str = S[s];
+    return d < std::size(str) ? 1u + static_cast<unsigned char>(std::begin(str)[d]) : 0u;
+  }
+
+  // The LCP of strings a and b, given that it is at least d, and
+  // stopping at max_d
+  size_t common_prefix(index a, index b, size_t d, size_t max_d = (std::numeric_limits<size_t>::max)()) const {
+    const auto& x = S[a];
+    const auto& y = S[b];
+    size_t max_len = (std::min)({std::size(x), std::size(y), max_d});
+    auto xs = std::begin(x);
+    auto ys = std::begin(y);
+    while (d < max_len && xs[d] == ys[d]) d++;
+    return d;
+  }
+
+  // Whether string a sorts before string b, given that their first d
+  // characters are equal
+  bool less(index a, index b, size_t d) const {
+    size_t l = common_prefix(a, b, d);
+    return key(a, l) < key(b, l);
+  }
+
+  // ----------------------------- Sequential -----------------------------
+
+  // Sort idx[start, end), whose strings share their first d characters, by
+  // multikey quicksort. Their LCPs are filled in after they are sorted,
+  // which reads at most the distinguishing prefixes again.
+  void sort_sequential(size_t start, size_t end, size_t d) {
+    multikey_quicksort(idx + start, end - start, d);
+    for (size_t i = start + 1; i < end; i++) {
+      lcp[i] = common_prefix(idx[i - 1], idx[i], d);
+    }
+  }
+
+  void insertion_sort(index* A, size_t n, size_t d) {
+    for (size_t i = 1; i < n; i++) {
+      index x = A[i];
+      size_t j = i;
+      for (; j > 0 && less(x, A[j - 1], d); j--) A[j] = A[j - 1];
+      A[j] = x;
+    }
+  }
+
+  void multikey_quicksort(index* A, size_t n, size_t d) {
+    while (n > STRING_SORT_INSERTION_SIZE) {
+      // Median of three pivot character
+      unsigned int a = key(A[0], d), b = key(A[n / 2], d), c = key(A[n - 1], d);
+      unsigned int pivot = (std::max)((std::min)(a, b), (std::min)((std::max)(a, b), c));
+
+      // Three way partition into [< pivot | == pivot | > pivot]
+      size_t lt = 0, i = 0, gt = n;
+      while (i < gt) {
+        unsigned int k = key(A[i], d);
+        if (k < pivot) std::swap(A[lt++], A[i++]);
+        else if (k > pivot) std::swap(A[i], A[--gt]);
+        else i++;
+      }
+
+      multikey_quicksort(A, lt, d);
+      multikey_quicksort(A + gt, n - gt, d);
+
+      // Strings that end at d are all equal, so only the rest of the
+      // middle part needs sorting on the next character
+      if (pivot == 0) return;
+      A += lt;
+      n = gt - lt;
+      d++;
+    }
+    insertion_sort(A, n, d);
+  }
+
+  // ------------------------------ Parallel ------------------------------
+
+  // Sort idx[start, end), whose strings share their first d characters,
+  // using tmp[start, end) as scratch space. lcp[start] is left for the
+  // caller, since it depends on the string before the group.
+  void sort(size_t start, size_t end, size_t d, index* tmp, float parallelism = 1.0) {
+    size_t n = end - start;
+    if (n <= 1) return;
+    if (n < STRING_SORT_BASE_CASE_SIZE || parallelism < .0001) {
+      sort_sequential(start, end, d);
+      return;
+    }
+
+    auto keys = sequence<uint16_t>::uninitialized(n);
+    while (true) {
+      parallel_for(0, n, [&](size_t i) { keys[i] = static_cast<uint16_t>(key(idx[start + i], d)); });
+      uint16_t first = keys[0];
+      auto differs = delayed_seq<size_t>(n, [&](size_t i) -> size_t { return keys[i] != first; });
+      if (internal::reduce(make_slice(differs), plus<size_t>()) > 0) break;
+
+      // Every string has the same character at d. If they all end there,
+      // they are equal. Otherwise skip as many shared characters as there
+      // are, up to a window, so that long shared prefixes take few rounds.
+      if (first == 0) {
+        parallel_for(start + 1, end, [&](size_t i) { lcp[i] = d; });
+        return;
+      }
+      index s = idx[start];
+      auto shared = delayed_seq<size_t>(n, [&](size_t i) -> size_t {
+        return common_prefix(s, idx[start + i], d, d + STRING_SORT_PREFIX_WINDOW);
+      });
+      d = internal::reduce(make_slice(shared), minimum<size_t>());
+    }
+
+    // Sort the indices into 257 buckets by the character at d
+    constexpr size_t num_buckets = 257;
+    auto In = make_slice(idx + start, idx + end);
+    auto Out = make_slice(tmp + start, tmp + end);
+    auto offsets = count_sort<uninitialized_copy_tag>(In, Out, make_slice(keys), num_buckets, parallelism).first;
+    parallel_for(0, n, [&](size_t i) { In[i] = Out[i]; });
+
+    // Each bucket's strings share the first d characters with every other
+    // string in the group, and the strings of bucket 0 end there, so they
+    // are all equal
+    parallel_for(0, num_buckets, [&](size_t b) {
+      size_t bucket_start = start + offsets[b];
+      size_t bucket_end = start + offsets[b + 1];
+      if (bucket_start == bucket_end) return;
+      if (bucket_start > start) lcp[bucket_start] = d;
+      if (b == 0) {
+        for (size_t i = bucket_start + 1; i < bucket_end; i++) lcp[i] = d;
+      }
+      else {
+        float new_parallelism = (parallelism * static_cast<float>(bucket_end - bucket_start)) / static_cast<float>(n + 1);
+        sort(bucket_start, bucket_end, d + 1, tmp, new_parallelism);
+      }
+    }, 1);
+  }
+};
+
+// Returns the permutation that sorts the strings of S, and the LCP array of
+// the sorted strings. The permutation gives the index into S of each string
+// in sorted order. The LCP array gives, at i > 0, the length of the longest
+// common prefix of sorted strings i-1 and i, and is 0 at i = 0.
+template <typename Iterator>
+std::pair<sequence<size_t>, sequence<size_t>> string_sort_index(slice<Iterator, Iterator> S) {
+  size_t n = S.size();
+  auto idx = sequence<size_t>::from_function(n, [](size_t i) { return i; });
+  auto lcp = sequence<size_t>::uninitialized(n);
+  if (n > 0) lcp[0] = 0;
+  auto tmp = sequence<size_t>::uninitialized(n);
+  string_sorter<Iterator> sorter{S, idx.data(), lcp.data()};
+  sorter.sort(0, n, 0, tmp.data());
+  return std::make_pair(std::move(idx), std::move(lcp));
+}
+
+}  // namespace internal
+}  // namespace parlay
+
+#endif  // PARLAY_INTERNAL_STRING_SORT_H_
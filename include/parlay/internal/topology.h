@@ -0,0 +1,195 @@
+// Discovery of the NUMA layout of the machine, used by the scheduler to
+// prefer stealing work from workers that share a memory node, and to
+// pin workers to CPUs.
+//
+// On Linux, the layout is read from /sys/devices/system/node. On other
+// platforms, or if the information is not available, the whole machine
+// is reported as a single node containing every hardware thread.
+
+#ifndef PARLAY_INTERNAL_TOPOLOGY_H_
+#define PARLAY_INTERNAL_TOPOLOGY_H_
+
+#include <cstddef>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace parlay {
+namespace internal {
+
+// Parse a Linux-style CPU (or node) list, e.g. "0-3,8,10-11"
+// into the sorted list of ids that it contains.
+inline std::vector<unsigned int> parse_cpu_list(const std::string& s) {
+  std::vector<unsigned int> result;
+  size_t i = 0;
+  auto read_number = [&]() -> long {
+    if (i >= s.size() || s[i] < '0' || s[i] > '9') return -1;
+    long x = 0;
+    while (i < s.size() && s[i] >= '0' && s[i] <= '9') x = 10 * x + (s[i++] - '0');
+    return x;
+  };
+  while (i < s.size()) {
+    long lo = read_number();
+    if (lo < 0) { i++; continue; }
+    long hi = lo;
+    if (i < s.size() && s[i] == '-') {
+      i++;
+      hi = read_number();
+      if (hi < lo) hi = lo;
+    }
+    for (long x = lo; x <= hi; x++) result.push_back(static_cast<unsigned int>(x));
+  }
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+  return result;
+}
+
+// True if s is a well-formed CPU list, e.g. "0-3,8,10-11", of at least one
+// id, with ranges in increasing order. Surrounding whitespace is ignored.
+inline bool is_cpu_list(const std::string& s) {
+  size_t first = s.find_first_not_of(" \t\n");
+  if (first == std::string::npos) return false;
+  size_t last = s.find_last_not_of(" \t\n") + 1;
+  size_t i = first;
+  auto read_number = [&](long& x) {
+    if (i >= last || s[i] < '0' || s[i] > '9') return false;
+    x = 0;
+    while (i < last && s[i] >= '0' && s[i] <= '9') x = 10 * x + (s[i++] - '0');
+    return true;
+  };
+  while (true) {
+    long lo, hi;
+    if (!read_number(lo)) return false;
+    if (i < last && s[i] == '-') {
+      i++;
+      if (!read_number(hi) || hi < lo) return false;
+    }
+    if (i == last) return true;
+    if (s[i++] != ',') return false;
+  }
+}
+
+struct numa_topology {
+
+  // node_cpus[i] is the sorted list of CPUs (numbered as by the OS) that
+  // belong to the i'th node, and node_ids[i] is the OS's id of that node.
+  // Only CPUs that the process is allowed to run on are included, and nodes
+  // without any such CPUs are omitted.
+  std::vector<std::vector<unsigned int>> node_cpus;
+  std::vector<unsigned int> node_ids;
+
+  [[nodiscard]] size_t num_nodes() const { return node_cpus.size(); }
+
+  [[nodiscard]] size_t num_cpus() const {
+    size_t total = 0;
+    for (const auto& cpus : node_cpus) total += cpus.size();
+    return total;
+  }
+};
+
+// Returns the set of CPUs that the process is allowed to run on, or an
+// empty list if this can not be determined on the current platform
+inline std::vector<unsigned int> allowed_cpus() {
+  std::vector<unsigned int> result;
+#if defined(__linux__)
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+    for (unsigned int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &mask)) result.push_back(cpu);
+    }
+  }
+#endif
+  return result;
+}
+
+inline numa_topology single_node_topology() {
+  numa_topology topology;
+  auto cpus = allowed_cpus();
+  if (cpus.empty()) {
+    unsigned int p = (std::max)(1u, std::thread::hardware_concurrency());
+    for (unsigned int cpu = 0; cpu < p; cpu++) cpus.push_back(cpu);
+  }
+  topology.node_cpus.push_back(std::move(cpus));
+  topology.node_ids.push_back(0);
+  return topology;
+}
+
+inline numa_topology discover_numa_topology() {
+#if defined(__linux__)
+  const std::string node_dir = "/sys/devices/system/node/";
+  std::ifstream online_file(node_dir + "online");
+  std::string online;
+  if (!online_file || !std::getline(online_file, online)) return single_node_topology();
+
+  auto allowed = allowed_cpus();
+  numa_topology topology;
+  for (unsigned int node : parse_cpu_list(online)) {
+    std::ifstream cpu_file(node_dir + "node" + std::to_string(node) + "/cpulist");
+    std::string cpulist;
+    if (!cpu_file || !std::getline(cpu_file, cpulist)) continue;
+    std::vector<unsigned int> cpus;
+    for (unsigned int cpu : parse_cpu_list(cpulist)) {
+      if (allowed.empty() || std::binary_search(allowed.begin(), allowed.end(), cpu)) cpus.push_back(cpu);
+    }
+    if (!cpus.empty()) {
+      topology.node_cpus.push_back(std::move(cpus));
+      topology.node_ids.push_back(node);
+    }
+  }
+  if (topology.node_cpus.empty()) return single_node_topology();
+  return topology;
+#else
+  return single_node_topology();
+#endif
+}
+
+// The topology of the machine, discovered once on first use
+extern inline const numa_topology& get_numa_topology() {
+  static const numa_topology topology = discover_numa_topology();
+  return topology;
+}
+
+// Returns the CPUs that the calling thread is allowed to run on, or an
+// empty list if this can not be determined on the current platform
+inline std::vector<unsigned int> current_thread_cpus() {
+  std::vector<unsigned int> result;
+#if defined(__linux__)
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  if (pthread_getaffinity_np(pthread_self(), sizeof(mask), &mask) == 0) {
+    for (unsigned int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &mask)) result.push_back(cpu);
+    }
+  }
+#endif
+  return result;
+}
+
+// Restrict the calling thread to run only on the given CPUs. Returns
+// false if this is not supported on the current platform or failed.
+inline bool bind_current_thread_to_cpus([[maybe_unused]] const std::vector<unsigned int>& cpus) {
+#if defined(__linux__)
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  for (unsigned int cpu : cpus) {
+    if (cpu < CPU_SETSIZE) CPU_SET(cpu, &mask);
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) == 0;
+#else
+  return false;
+#endif
+}
+
+}  // namespace internal
+}  // namespace parlay
+
+#endif  // PARLAY_INTERNAL_TOPOLOGY_H_
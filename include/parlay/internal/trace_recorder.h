@@ -0,0 +1,32 @@
+// The interface through which the scheduler reports the events of its
+// workers when compiled with PARLAY_SCHEDULER_TRACE. See trace.h for a
+// recorder that keeps them in per-worker ring buffers.
+
+#ifndef PARLAY_INTERNAL_TRACE_RECORDER_H_
+#define PARLAY_INTERNAL_TRACE_RECORDER_H_
+
+#include <cstddef>
+
+namespace parlay {
+namespace internal {
+
+enum class trace_event_type : unsigned char {
+  job_begin,      // arg is the priority level of the job
+  job_end,
+  steal,          // arg is the id of the worker that the job was stolen from
+  sleep_begin,
+  sleep_end
+};
+
+// Receives the events of the workers of a scheduler. Each worker only
+// calls record() with its own id, so per-worker storage needs no locking.
+struct trace_recorder {
+  virtual void record(size_t worker, trace_event_type type, size_t arg) noexcept = 0;
+ protected:
+  ~trace_recorder() = default;
+};
+
+}  // namespace internal
+}  // namespace parlay
+
+#endif  // PARLAY_INTERNAL_TRACE_RECORDER_H_
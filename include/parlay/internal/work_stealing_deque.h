@@ -62,6 +62,29 @@ struct Deque {
     return (local_bot == 1);
   }
 
+  // True if at least n more jobs can be pushed before the queue overflows.
+  // Only meaningful when called by the owning thread.
+  bool has_room(int n) const {
+    return static_cast<int>(bot.load(std::memory_order_relaxed)) + n < q_size;
+  }
+
+  // The number of jobs on the queue. Only meaningful when called by the
+  // owning thread, and may be stale by the time it returns.
+  size_t size() const {
+    auto local_bot = bot.load(std::memory_order_relaxed);
+    auto top = age.load(std::memory_order_relaxed).top;
+    return local_bot > top ? local_bot - top : 0;
+  }
+
+  // True if the queue may have jobs. Unlike size(), any thread can call it.
+  // A job pushed before a seq_cst fence that precedes the call is seen,
+  // unless it has been popped since.
+  bool maybe_nonempty() const {
+    auto top = age.load(std::memory_order_seq_cst).top;
+    auto local_bot = bot.load(std::memory_order_seq_cst);
+    return local_bot > top;
+  }
+
   // Pop an item from the top of the queue, i.e., the end that is not
   // pushed onto. Threads other than the owner can use this function.
   //
@@ -19,6 +19,11 @@ struct WorkStealingJob {
   virtual ~WorkStealingJob() = default;
   void operator()() {
     assert(done.load(std::memory_order_relaxed) == false);
+    if (detached) {
+      execute();
+      delete this;
+      return;
+    }
     execute();
     done.store(true, std::memory_order_release);
   }
@@ -30,8 +35,14 @@ struct WorkStealingJob {
       std::this_thread::yield();
   }
  protected:
+  // A detached job is heap allocated and owned by the scheduler, which
+  // deletes it after running it. Nobody may wait on a detached job.
+  struct detached_t { };
+  explicit WorkStealingJob(detached_t) : done{false}, detached{true} { }
+
   virtual void execute() = 0;
   std::atomic<bool> done;
+  bool detached{false};
 };
 
 // Holds a type-specific reference to a callable object
@@ -0,0 +1,309 @@
+// A nested_sequence is a sequence of sequences stored flat, in the style
+// of a compressed sparse row (CSR) matrix. It consists of two sequences:
+// the values of all of the inner sequences, stored contiguously one after
+// the other, and an offsets sequence, whose i'th element is the position
+// in the values of the first element of the i'th inner sequence. Compared
+// with a sequence<sequence<T>>, this takes two allocations in total rather
+// than one per inner sequence, and keeps all of the values together.
+//
+// A nested_sequence is a random-access range whose elements are slices of
+// its values, e.g.,
+//
+//    auto graph = parlay::nested_group_by_index(edges, n);
+//    parlay::parallel_for(0, graph.size(), [&](size_t u) {
+//      for (auto v : graph[u]) { ... }
+//    });
+//
+// The number of inner sequences is fixed at construction, but their
+// elements can be modified through the slices.
+//
+
+#ifndef PARLAY_NESTED_SEQUENCE_H_
+#define PARLAY_NESTED_SEQUENCE_H_
+
+#include <cassert>
+#include <cstddef>
+
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "monoid.h"
+#include "parallel.h"
+#include "range.h"
+#include "relocation.h"
+#include "sequence.h"
+#include "slice.h"
+#include "utilities.h"
+
+#include "internal/sequence_ops.h"
+
+namespace parlay {
+
+template<typename T, typename Allocator = internal::sequence_default_allocator<T>>
+class nested_sequence {
+
+ public:
+
+  using values_type = sequence<T, Allocator>;
+  using offsets_type = sequence<size_t>;
+
+  // The elements of a nested sequence are slices of its values. Since they
+  // are views, they are also its value_type, so to_sequence on a nested
+  // sequence produces a sequence of slices rather than copying the values.
+  using value_type = slice<typename values_type::iterator, typename values_type::iterator>;
+  using reference = value_type;
+  using const_reference = slice<typename values_type::const_iterator, typename values_type::const_iterator>;
+  using difference_type = std::ptrdiff_t;
+  using size_type = size_t;
+
+  // ------------------------------------------------
+  //    Iterator over the inner sequences
+  // ------------------------------------------------
+  template<typename ValuesIterator>
+  class iterator_t {
+   public:
+
+    // Iterator traits
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = slice<ValuesIterator, ValuesIterator>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = value_type;
+
+    friend class nested_sequence<T, Allocator>;
+
+    // Value-initialized (default constructed) iterators
+    // compare equal, but should not be dereferenced
+    iterator_t() : offset(nullptr), values() {}
+
+    // Allow conversion from iterator to const_iterator
+    template<typename OtherIterator, typename = std::enable_if_t<
+        std::is_convertible_v<OtherIterator, ValuesIterator> && !std::is_same_v<OtherIterator, ValuesIterator>>>
+    iterator_t(const iterator_t<OtherIterator>& other) : offset(other.offset), values(other.values) {}  // NOLINT
+
+    reference operator*() const { return make_slice(values + offset[0], values + offset[1]); }
+
+    reference operator[](size_t i) const { return make_slice(values + offset[i], values + offset[i + 1]); }
+
+    iterator_t& operator++() { offset++; return *this; }
+    iterator_t operator++(int) { auto tmp = *this; offset++; return tmp; }
+    iterator_t& operator--() { offset--; return *this; }
+    iterator_t operator--(int) { auto tmp = *this; offset--; return tmp; }
+
+    iterator_t& operator+=(difference_type delta) { offset += delta; return *this; }
+    iterator_t& operator-=(difference_type delta) { offset -= delta; return *this; }
+    iterator_t operator+(difference_type delta) const { return iterator_t(offset + delta, values); }
+    iterator_t operator-(difference_type delta) const { return iterator_t(offset - delta, values); }
+    friend iterator_t operator+(difference_type delta, const iterator_t& it) { return it + delta; }
+
+    difference_type operator-(const iterator_t& other) const { return offset - other.offset; }
+
+    bool operator==(const iterator_t& other) const { return offset == other.offset; }
+    bool operator!=(const iterator_t& other) const { return offset != other.offset; }
+    bool operator<(const iterator_t& other) const { return offset < other.offset; }
+    bool operator>(const iterator_t& other) const { return offset > other.offset; }
+    bool operator<=(const iterator_t& other) const { return offset <= other.offset; }
+    bool operator>=(const iterator_t& other) const { return offset >= other.offset; }
+
+   private:
+    template<typename> friend class iterator_t;
+
+    iterator_t(const size_t* offset_, ValuesIterator values_) : offset(offset_), values(values_) {}
+
+    const size_t* offset;
+    ValuesIterator values;
+  };
+
+  using iterator = iterator_t<typename values_type::iterator>;
+  using const_iterator = iterator_t<typename values_type::const_iterator>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  // ----------- Constructors and Factories ---------------
+
+  // An empty nested sequence
+  nested_sequence() = default;
+
+  // Take ownership of the given offsets and values without copying them.
+  // The offsets must be non-decreasing, and contain one more element than
+  // the number of inner sequences, the last being the number of values.
+  // This is the format of the bucket offsets returned by the counting and
+  // integer sorts, so their output can be wrapped up directly.
+  nested_sequence(offsets_type offsets_, values_type values_)
+      : _offsets(std::move(offsets_)), _values(std::move(values_)) {
+    assert(_offsets.empty() ? _values.empty() : (_offsets.front() == 0 && _offsets.back() == _values.size()));
+  }
+
+  // Copy the given range of ranges into a nested sequence
+  template<typename R, typename = std::enable_if_t<
+      is_random_access_range_v<R> && !std::is_same_v<std::decay_t<R>, nested_sequence>>>
+  explicit nested_sequence(R&& r) {
+    static_assert(is_random_access_range_v<range_reference_type_t<R>>);
+    static_assert(std::is_constructible_v<T, range_reference_type_t<range_reference_type_t<R>>>);
+
+    size_t n = parlay::size(r);
+    _offsets = offsets_type::uninitialized(n + 1);
+    parallel_for(0, n, [&, it = std::begin(r)](size_t i) { _offsets[i] = parlay::size(it[i]); });
+    _offsets[n] = 0;
+    size_t m = internal::scan_inplace(make_slice(_offsets), plus<size_t>());
+    _values = values_type::uninitialized(m);
+    parallel_for(0, n, [&, it = std::begin(r)](size_t i) {
+      auto&& inner = it[i];
+      auto dit = _values.begin() + _offsets[i];
+      parallel_for(0, parlay::size(inner), [&, sit = std::begin(inner)](size_t j) {
+        assign_uninitialized(dit[j], sit[j]);
+      }, 1000);
+    });
+  }
+
+  // Relocate the elements of a sequence of sequences into a nested
+  // sequence, and free the inner sequences
+  template<typename InnerAllocator, typename OuterAllocator>
+  explicit nested_sequence(sequence<sequence<T, InnerAllocator>, OuterAllocator>&& r) {
+    size_t n = r.size();
+    _offsets = offsets_type::uninitialized(n + 1);
+    parallel_for(0, n, [&](size_t i) { _offsets[i] = r[i].size(); });
+    _offsets[n] = 0;
+    size_t m = internal::scan_inplace(make_slice(_offsets), plus<size_t>());
+    _values = values_type::uninitialized(m);
+    parallel_for(0, n, [&](size_t i) {
+      parlay::uninitialized_relocate(r[i].begin(), r[i].end(), _values.begin() + _offsets[i]);
+      clear_relocated(r[i]);
+    });
+    r.clear();
+  }
+
+  // Make a nested sequence whose i'th inner sequence has sizes[i] elements,
+  // taking ownership of the given values, which contain all of them in order
+  template<typename R>
+  static nested_sequence from_sizes(R&& sizes, values_type values_) {
+    static_assert(is_random_access_range_v<R>);
+    static_assert(std::is_convertible_v<range_reference_type_t<R>, size_t>);
+    size_t n = parlay::size(sizes);
+    auto offsets_ = offsets_type::from_function(n + 1, [&, it = std::begin(sizes)](size_t i) -> size_t {
+      return (i == n) ? 0 : it[i];
+    });
+    [[maybe_unused]] size_t m = internal::scan_inplace(make_slice(offsets_), plus<size_t>());
+    assert(m == values_.size());
+    return nested_sequence(std::move(offsets_), std::move(values_));
+  }
+
+  // Default copy & move, constructor and assignment
+  nested_sequence(const nested_sequence&) = default;
+  nested_sequence(nested_sequence&&) noexcept = default;
+  nested_sequence& operator=(const nested_sequence&) = default;
+  nested_sequence& operator=(nested_sequence&&) noexcept = default;
+
+  // ---------------- Iterator Pairs --------------------
+
+  iterator begin() { return iterator(_offsets.data(), _values.begin()); }
+  iterator end() { return iterator(_offsets.data() + size(), _values.begin()); }
+
+  const_iterator begin() const { return const_iterator(_offsets.data(), _values.begin()); }
+  const_iterator end() const { return const_iterator(_offsets.data() + size(), _values.begin()); }
+
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  reverse_iterator rbegin() { return std::make_reverse_iterator(end()); }
+  reverse_iterator rend() { return std::make_reverse_iterator(begin()); }
+
+  const_reverse_iterator rbegin() const { return std::make_reverse_iterator(end()); }
+  const_reverse_iterator rend() const { return std::make_reverse_iterator(begin()); }
+
+  // ---------------- Other operations --------------------
+
+  // Subscript access
+  reference operator[](size_t i) { return begin()[i]; }
+  const_reference operator[](size_t i) const { return begin()[i]; }
+
+  // Subscript access with bounds checking
+  reference at(size_t i) {
+    check_range(i);
+    return begin()[i];
+  }
+
+  const_reference at(size_t i) const {
+    check_range(i);
+    return begin()[i];
+  }
+
+  reference front() { assert(!empty()); return (*this)[0]; }
+  const_reference front() const { assert(!empty()); return (*this)[0]; }
+
+  reference back() { assert(!empty()); return (*this)[size() - 1]; }
+  const_reference back() const { assert(!empty()); return (*this)[size() - 1]; }
+
+  // The number of inner sequences
+  [[nodiscard]] size_t size() const { return _offsets.empty() ? 0 : _offsets.size() - 1; }
+
+  [[nodiscard]] bool empty() const { return size() == 0; }
+
+  // The number of elements of the i'th inner sequence
+  [[nodiscard]] size_t inner_size(size_t i) const { return _offsets[i + 1] - _offsets[i]; }
+
+  // The total number of elements of all of the inner sequences
+  [[nodiscard]] size_t flat_size() const { return _values.size(); }
+
+  // The offsets and the values, read only. The values are also accessible
+  // for modification as a slice, since their number can not change
+  const offsets_type& offsets() const { return _offsets; }
+  const values_type& values() const { return _values; }
+  auto values() { return make_slice(_values); }
+
+  // Remove all of the inner sequences
+  void clear() {
+    _offsets.clear();
+    _values.clear();
+  }
+
+  // Give up ownership of the offsets and values, leaving this empty
+  std::pair<offsets_type, values_type> release() {
+    return std::make_pair(std::move(_offsets), std::move(_values));
+  }
+
+  void swap(nested_sequence& other) noexcept {
+    _offsets.swap(other._offsets);
+    _values.swap(other._values);
+  }
+
+  bool operator==(const nested_sequence& other) const {
+    return size() == other.size() && (empty() || (_offsets == other._offsets && _values == other._values));
+  }
+
+  bool operator!=(const nested_sequence& other) const { return !(*this == other); }
+
+ private:
+
+  void check_range(size_t i) const {
+    if (i >= size()) {
+      throw_exception_or_terminate<std::out_of_range>("nested_sequence access out of bounds: length = " +
+                                                      std::to_string(size()) + ", index = " + std::to_string(i));
+    }
+  }
+
+  offsets_type _offsets;
+  values_type _values;
+};
+
+// Copy an arbitrary range of ranges into a nested sequence. The value
+// type is deduced from the value type of the inner ranges.
+template<typename R>
+auto to_nested_sequence(R&& r) {
+  static_assert(is_random_access_range_v<R>);
+  static_assert(is_random_access_range_v<range_reference_type_t<R>>);
+  return nested_sequence<range_value_type_t<range_reference_type_t<R>>>(std::forward<R>(r));
+}
+
+// Relocate the contents of a sequence of sequences into a nested sequence
+template<typename T, typename InnerAllocator, typename OuterAllocator>
+auto to_nested_sequence(sequence<sequence<T, InnerAllocator>, OuterAllocator>&& r) {
+  return nested_sequence<T>(std::move(r));
+}
+
+}  // namespace parlay
+
+#endif  // PARLAY_NESTED_SEQUENCE_H_
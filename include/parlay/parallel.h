@@ -12,6 +12,9 @@
 #include <type_traits>  // IWYU pragma: keep
 #include <utility>
 
+#include "internal/granularity.h"
+#include "internal/scheduler_stats.h"
+
 // ----------------------------------------------------------------------------
 // All scheduler plugins are required to implement the
 // following four functions to integrate with parlay:
@@ -29,6 +32,13 @@ inline size_t num_workers();
 // id of running thread, should be numbered from [0...num-workers)
 inline size_t worker_id();
 
+// number of NUMA nodes that the workers are spread over, the node of the
+// running worker in [0...num_numa_nodes()), and the number of workers on a
+// given node. Schedulers other than Parlay's report a single node.
+inline size_t num_numa_nodes();
+inline size_t numa_node_id();
+inline size_t num_workers_on_node(size_t node);
+
 // parallel loop from start (inclusive) to end (exclusive) running
 // function f.
 //    f should map size_t to void.
@@ -39,12 +49,39 @@ template <typename F>
 inline void parallel_for(size_t start, size_t end, F&& f, long granularity = 0,
                          bool conservative = false);
 
+// parallel loop whose granularity is learned across calls by the given
+// controller (see internal/granularity.h), so that only the first call
+// times a sequential prefix of the loop to choose it. Schedulers other
+// than Parlay's ignore the controller.
+template <typename F>
+inline void parallel_for(size_t start, size_t end, F&& f, granularity_controller& controller,
+                         bool conservative = false);
+
 // runs the thunks left and right in parallel.
 //    both left and write should map void to void
 //    conservative uses a safer scheduler
 template <typename Lf, typename Rf>
 inline void par_do(Lf&& left, Rf&& right, bool conservative = false);
 
+// priority levels for execute_with_priority
+enum class priority { background = 0, normal = 1, high = 2 };
+
+// runs the thunk f, such that the parallel work that it creates is scheduled
+// at the given priority. Idle workers prefer to steal work of higher priority,
+// and workers running lower priority work pick up higher priority work at
+// their next fork, so latency-critical work is not stuck behind large amounts
+// of background work. Schedulers other than Parlay's ignore the priority.
+template <typename F>
+inline void execute_with_priority(priority p, F&& f);
+
+// a snapshot of per-worker statistics of the current scheduler (jobs run,
+// steals, time spent looking for work and asleep, deque high-water marks),
+// and a call to zero them, e.g., before a timed region. Statistics are only
+// collected if compiled with PARLAY_SCHEDULER_STATS; otherwise, and with
+// schedulers other than Parlay's, the snapshot has no workers.
+inline scheduler_statistics scheduler_stats();
+inline void reset_scheduler_stats();
+
 // ----------------------------------------------------------------------------
 //          Extra functions implemented on top of the four basic ones
 //
@@ -163,6 +200,15 @@ inline unsigned int init_num_workers() {
   }
 }
 
+// Determine how workers are pinned to CPUs
+inline affinity_policy init_affinity_policy() {
+  if (const auto env_p = std::getenv("PARLAY_AFFINITY")) {
+    return affinity_policy::from_string(env_p);
+  } else {
+    return affinity_policy::none();
+  }
+}
+
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
@@ -172,7 +218,7 @@ using scheduler_type = scheduler<WorkStealingJob>;
 extern inline scheduler_type& get_current_scheduler() {
   auto current_scheduler = scheduler_type::get_current_scheduler();
   if (current_scheduler == nullptr) {
-    static thread_local scheduler_type local_scheduler(init_num_workers());
+    static thread_local scheduler_type local_scheduler(init_num_workers(), init_affinity_policy());
     return local_scheduler;
   }
   return *current_scheduler;
@@ -188,6 +234,18 @@ inline size_t worker_id() {
   return internal::get_current_scheduler().worker_id();
 }
 
+inline size_t num_numa_nodes() {
+  return internal::get_current_scheduler().num_numa_nodes();
+}
+
+inline size_t numa_node_id() {
+  return internal::get_current_scheduler().numa_node_id();
+}
+
+inline size_t num_workers_on_node(size_t node) {
+  return internal::get_current_scheduler().num_workers_on_node(node);
+}
+
 template <typename F>
 inline void parallel_for(size_t start, size_t end, F&& f, long granularity, bool conservative) {
   static_assert(std::is_invocable_v<F&, size_t>);
@@ -204,6 +262,19 @@ inline void parallel_for(size_t start, size_t end, F&& f, long granularity, bool
   }
 }
 
+template <typename F>
+inline void parallel_for(size_t start, size_t end, F&& f, granularity_controller& controller, bool conservative) {
+  static_assert(std::is_invocable_v<F&, size_t>);
+
+  if (start + 1 == end) {
+    f(start);
+  }
+  else if (end > start) {
+    fork_join_scheduler::parfor(internal::get_current_scheduler(), start, end,
+      std::forward<F>(f), controller, conservative);
+  }
+}
+
 template <typename Lf, typename Rf>
 inline void par_do(Lf&& left, Rf&& right, bool conservative) {
   static_assert(std::is_invocable_v<Lf&&>);
@@ -211,6 +282,21 @@ inline void par_do(Lf&& left, Rf&& right, bool conservative) {
   return fork_join_scheduler::pardo(internal::get_current_scheduler(), std::forward<Lf>(left), std::forward<Rf>(right), conservative);
 }
 
+template <typename F>
+inline void execute_with_priority(priority p, F&& f) {
+  static_assert(std::is_invocable_v<F&&>);
+  static_assert(static_cast<unsigned int>(priority::normal) == internal::scheduler_type::normal_priority);
+  internal::get_current_scheduler().run_with_priority(static_cast<unsigned int>(p), std::forward<F>(f));
+}
+
+inline scheduler_statistics scheduler_stats() {
+  return internal::get_current_scheduler().statistics();
+}
+
+inline void reset_scheduler_stats() {
+  internal::get_current_scheduler().reset_statistics();
+}
+
 // Execute the given function f() on p threads inside its own private scheduler instance
 //
 // The scheduler instance is destroyed upon completion and can not be re-used. Creating a
@@ -221,6 +307,41 @@ void execute_with_scheduler(unsigned int p, F&& f) {
   std::invoke(std::forward<F>(f));
 }
 
+// Execute the given function f() on p threads inside its own private scheduler instance,
+// whose workers are pinned to CPUs according to the given affinity policy. Schedulers
+// given disjoint explicit CPU lists do not compete with each other for cores.
+template <typename F>
+void execute_with_scheduler(unsigned int p, affinity_policy affinity, F&& f) {
+  internal::scheduler_type scheduler(p, std::move(affinity));
+  std::invoke(std::forward<F>(f));
+}
+
+}  // namespace parlay
+
+#endif
+
+#if !defined(PARLAY_USING_PARLAY_SCHEDULER)
+
+namespace parlay {
+
+inline size_t num_numa_nodes() { return 1; }
+inline size_t numa_node_id() { return 0; }
+inline size_t num_workers_on_node(size_t node) { return node == 0 ? num_workers() : 0; }
+
+inline scheduler_statistics scheduler_stats() { return {}; }
+inline void reset_scheduler_stats() { }
+
+template <typename F>
+inline void parallel_for(size_t start, size_t end, F&& f, granularity_controller&, bool conservative) {
+  parallel_for(start, end, std::forward<F>(f), 0, conservative);
+}
+
+template <typename F>
+inline void execute_with_priority(priority, F&& f) {
+  static_assert(std::is_invocable_v<F&&>);
+  std::forward<F>(f)();
+}
+
 }  // namespace parlay
 
 #endif
@@ -23,10 +23,12 @@
 #include "internal/merge_sort.h"
 #include "internal/sequence_ops.h"        // IWYU pragma: export
 #include "internal/sample_sort.h"
+#include "internal/string_sort.h"
 
 #include "delayed.h"
 #include "delayed_sequence.h"
 #include "monoid.h"                       // IWYU pragma: export
+#include "nested_sequence.h"              // IWYU pragma: export
 #include "parallel.h"
 #include "random.h"
 #include "range.h"
@@ -355,7 +357,15 @@ void sort_inplace(R&& in, Compare&& comp) {
   static_assert(is_random_access_range_v<R>);
   static_assert(std::is_invocable_r_v<bool, Compare, range_reference_type_t<R>, range_reference_type_t<R>>);
   static_assert(std::is_swappable_v<range_reference_type_t<R>>);
-  internal::sample_sort_inplace(make_slice(in), std::forward<Compare>(comp));
+  using value_type = range_value_type_t<R>;
+  // The block sample sort needs copies of the splitters, but no temporary
+  // copy of the input, so it is used whenever the elements allow it
+  if constexpr (is_trivially_relocatable_v<value_type> && std::is_copy_constructible_v<value_type>) {
+    internal::block_sample_sort_inplace(make_slice(in), std::forward<Compare>(comp));
+  }
+  else {
+    internal::sample_sort_inplace(make_slice(in), std::forward<Compare>(comp));
+  }
 }
 
 template<typename R>
@@ -408,9 +418,11 @@ void integer_sort_inplace(R&& in) {
   static_assert(is_random_access_range_v<R>);
   static_assert(std::is_integral_v<range_value_type_t<R>>);
   static_assert(std::is_unsigned_v<range_value_type_t<R>>);
-  internal::integer_sort_inplace(make_slice(in), [](auto x) { return x; });
+  internal::radix_sort_inplace(make_slice(in), [](auto x) { return x; });
 }
 
+// Unlike stable_integer_sort_inplace, sorts trivially relocatable types
+// without a temporary copy of the input
 template<typename R, typename Key>
 void integer_sort_inplace(R&& in, Key&& key) {
   static_assert(is_random_access_range_v<R>);
@@ -419,7 +431,10 @@ void integer_sort_inplace(R&& in, Key&& key) {
   static_assert(std::is_integral_v<key_type>);
   static_assert(std::is_unsigned_v<key_type>);
   static_assert(std::is_swappable_v<range_reference_type_t<R>>);
-  internal::integer_sort_inplace(make_slice(in), std::forward<Key>(key));
+  if constexpr (is_trivially_relocatable_v<range_value_type_t<R>>)
+    internal::radix_sort_inplace(make_slice(in), std::forward<Key>(key));
+  else
+    internal::integer_sort_inplace(make_slice(in), std::forward<Key>(key));
 }
 
 template<typename R, typename Key>
@@ -444,6 +459,51 @@ void stable_integer_sort_inplace(R&& in, Key&& key) {
   internal::integer_sort_inplace(make_slice(in), std::forward<Key>(key));
 }
 
+/* -------------------- String Sorting -------------------- */
+
+// Strings are random-access ranges of one-byte characters, such as
+// std::string or parlay::sequence<char>. They are sorted lexicographically
+// with characters compared as unsigned, as for std::string, and the LCP
+// array of the sorted strings is computed along the way. lcp[i] is the
+// length of the longest common prefix of sorted strings i-1 and i, and
+// lcp[0] is 0.
+
+// Returns the permutation that sorts the strings, i.e. the index of each
+// string of the input in sorted order, and the LCP array
+template<typename R>
+[[nodiscard]] auto string_sort_index(R&& in) {
+  static_assert(is_random_access_range_v<R>);
+  static_assert(is_random_access_range_v<range_reference_type_t<R>>);
+  static_assert(std::is_integral_v<range_value_type_t<range_value_type_t<R>>>);
+  static_assert(sizeof(range_value_type_t<range_value_type_t<R>>) == 1);
+  return internal::string_sort_index(make_slice(in));
+}
+
+// Returns the sorted strings and their LCP array
+template<typename R>
+[[nodiscard]] auto string_sort(R&& in) {
+  static_assert(std::is_constructible_v<range_value_type_t<R>, range_reference_type_t<R>>);
+  auto [permutation, lcp] = parlay::string_sort_index(in);
+  auto sorted = tabulate(permutation.size(), [&, &permutation = permutation](size_t i) -> range_value_type_t<R> {
+    return std::begin(in)[permutation[i]];
+  });
+  return std::make_pair(std::move(sorted), std::move(lcp));
+}
+
+// Sorts the strings in place, and returns their LCP array
+template<typename R>
+sequence<size_t> string_sort_inplace(R&& in) {
+  using value_type = range_value_type_t<R>;
+  auto [permutation, lcp] = parlay::string_sort_index(in);
+  size_t n = permutation.size();
+  auto tmp = internal::uninitialized_sequence<value_type>(n);
+  parallel_for(0, n, [&, &permutation = permutation](size_t i) {
+    parlay::uninitialized_relocate_n(std::begin(in) + permutation[i], 1, tmp.begin() + i);
+  });
+  parlay::uninitialized_relocate(tmp.begin(), tmp.end(), std::begin(in));
+  return std::move(lcp);
+}
+
 /* -------------------- Counting Sort -------------------- */
 
 template<typename Range>
@@ -763,8 +823,9 @@ inline bool lexicographical_compare(R1&& r1, R2&& r2) {
   static_assert(is_less_than_comparable_v<range_reference_type_t<R1>, range_reference_type_t<R2>>);
   return parlay::lexicographical_compare(std::forward<R1>(r1), std::forward<R2>(r2), std::less<>{});}
 
-template <typename T, typename Alloc, bool EnableSSO>
-inline bool operator<(const sequence<T,Alloc,EnableSSO> &a, const sequence<T,Alloc,EnableSSO> &b) {
+template <typename T, typename Alloc, bool EnableSSO, size_t InlineCapacity>
+inline bool operator<(const sequence<T,Alloc,EnableSSO,InlineCapacity> &a,
+                      const sequence<T,Alloc,EnableSSO,InlineCapacity> &b) {
   if (a.size() > 1000) 
     return lexicographical_compare(a, b);
   auto sa = a.begin();
@@ -1018,6 +1079,23 @@ auto flatten(sequence<sequence<T>>&& r) {
   return res;
 }
 
+// The values of a nested sequence are already flat, so flattening one
+// copies them, or for an rvalue, takes them without copying
+template <typename T, typename Alloc>
+auto flatten(const nested_sequence<T, Alloc>& r) {
+  return r.values();
+}
+
+template <typename T, typename Alloc>
+auto flatten(nested_sequence<T, Alloc>& r) {
+  return std::as_const(r).values();
+}
+
+template <typename T, typename Alloc>
+auto flatten(nested_sequence<T, Alloc>&& r) {
+  return std::move(r.release().second);
+}
+
 /* -------------------- Tokens and split -------------------- */
 
 // Return true if the given character is considered whitespace.
@@ -1139,6 +1217,45 @@ sequence<parlay::chars> tokens(Range&& R, UnaryPred&& is_space = is_whitespace)
   else return map_tokens(R, to_token, is_space);
 }
 
+// Like tokens, but returns the tokens as a nested_sequence, i.e., the
+// characters of all of the tokens in one flat sequence, and their offsets,
+// rather than allocating a sequence per token.
+template <typename Range, typename UnaryPred = decltype(is_whitespace)>
+nested_sequence<char> nested_tokens(Range&& R, UnaryPred&& is_space = is_whitespace) {
+  static_assert(is_random_access_range_v<Range>);
+  static_assert(std::is_convertible_v<range_reference_type_t<Range>, char>);
+  static_assert(std::is_invocable_r_v<bool, UnaryPred, range_reference_type_t<Range>>);
+
+  auto S = make_slice(R);
+  size_t n = S.size();
+  if (n == 0) return {};
+
+  // The start and end of each token, interleaved
+  sequence<size_t> Locations = internal::delayed::to_sequence(
+                               internal::delayed::filter_op(
+                                 parlay::iota<size_t>(n + 1),
+                                 [&](size_t i) -> std::optional<size_t> {
+    if ((i == 0) ? !is_space(S[0]) : (i == n) ? !is_space(S[n - 1]) : is_space(S[i - 1]) != is_space(S[i]))
+      return std::make_optional(i);
+    else
+      return std::nullopt;
+  }));
+
+  size_t m = Locations.size() / 2;
+  auto offsets = sequence<size_t>::from_function(m + 1, [&](size_t i) -> size_t {
+    return (i == m) ? 0 : Locations[2 * i + 1] - Locations[2 * i]; });
+  size_t len = internal::scan_inplace(make_slice(offsets), plus<size_t>());
+  auto values = sequence<char>::uninitialized(len);
+  parallel_for(0, m, [&](size_t i) {
+    auto dit = std::begin(values) + offsets[i];
+    auto sit = std::begin(S) + Locations[2 * i];
+    parallel_for(0, offsets[i + 1] - offsets[i], [=] (size_t j) {
+      assign_uninitialized(*(dit+j), static_cast<char>(*(sit+j)));
+    }, 1000);
+  });
+  return nested_sequence<char>(std::move(offsets), std::move(values));
+}
+
 // Like split_at, but applies the given function f to each of the
 // contiguous subsequences of R delimited by positions i such that
 // flags[i] is (or converts to) true.
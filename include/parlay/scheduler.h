@@ -9,12 +9,25 @@
 #include <algorithm>
 #include <atomic>
 #include <chrono>         // IWYU pragma: keep
+#include <iostream>
 #include <memory>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <string>
 #include <thread>
 #include <type_traits>    // IWYU pragma: keep
 #include <utility>
 #include <vector>
 
+#include "portability.h"
+
+#include "internal/current_arena.h"
+#include "internal/granularity.h"
+#include "internal/growable_deque.h"
+#include "internal/scheduler_stats.h"
+#include "internal/topology.h"
+#include "internal/trace_recorder.h"
 #include "internal/work_stealing_deque.h"         // IWYU pragma: keep
 #include "internal/work_stealing_job.h"
 
@@ -44,18 +57,142 @@
 #endif
 
 
+// True if the scheduler should take the NUMA layout of the machine
+// into account. Workers are spread over the nodes in proportion to
+// their number of CPUs. Workers are not bound to the CPUs of their node
+// unless asked to by affinity_policy::nodes(), and only workers that are
+// pinned by some policy prefer to steal from workers on the same node.
+// Has no effect on machines with a single node.
+//
+// Default: true
+#ifndef PARLAY_NUMA_AWARE
+#define PARLAY_NUMA_AWARE true
+#endif
+
+
+// PARLAY_NUMA_REMOTE_STEAL_ATTEMPTS sets the number of attempts
+// that a NUMA-aware worker makes to steal from other nodes after
+// each round of unsuccessful attempts on its own node. Each round
+// makes two attempts per worker on the node.
+//
+// Default: 2
+#ifndef PARLAY_NUMA_REMOTE_STEAL_ATTEMPTS
+#define PARLAY_NUMA_REMOTE_STEAL_ATTEMPTS 2
+#endif
+
+
+// True if the scheduler should be able to report the jobs that each
+// worker runs, its steals, and when it sleeps, to a recorder such as a
+// parlay::scheduler_trace (see trace.h). Costs a check for an active
+// recorder at every job, even when nothing is being traced.
+//
+// Default: false
+#ifndef PARLAY_SCHEDULER_TRACE
+#define PARLAY_SCHEDULER_TRACE false
+#endif
+
+
+// True if workers should use growable Chase-Lev deques, from which thieves
+// steal half of the jobs at a time, instead of fixed-size deques of 1000
+// jobs from which they steal one job at a time. Growable deques can not
+// overflow under deep nesting of forks, and need fewer steals to spread
+// fine-grained work, but pop_bottom needs a CAS for the last few jobs.
+//
+// Default: false
+#ifndef PARLAY_GROWABLE_DEQUE
+#define PARLAY_GROWABLE_DEQUE false
+#endif
+
+
+// A worker that has no local work makes rounds of attempts to steal, of
+// PARLAY_STEAL_ATTEMPTS_PER_WORKER attempts per worker each. The first
+// PARLAY_STEAL_SPIN_ROUNDS rounds are followed by a yield, so a worker
+// that has just run out of work picks up new work quickly. Later rounds
+// are followed by a sleep of PARLAY_STEAL_BACKOFF_NS nanoseconds per
+// worker, to save cycles. Once PARLAY_ELASTIC_STEAL_TIMEOUT has passed
+// without success, the worker parks until it is woken up.
+//
+// Defaults: 200, 8, and 100
+#ifndef PARLAY_STEAL_ATTEMPTS_PER_WORKER
+#define PARLAY_STEAL_ATTEMPTS_PER_WORKER 200
+#endif
+
+#ifndef PARLAY_STEAL_SPIN_ROUNDS
+#define PARLAY_STEAL_SPIN_ROUNDS 8
+#endif
+
+#ifndef PARLAY_STEAL_BACKOFF_NS
+#define PARLAY_STEAL_BACKOFF_NS 100
+#endif
+
+
 #if PARLAY_ELASTIC_PARALLELISM
-#include "internal/atomic_wait.h"
+#include "internal/eventcount.h"
 #endif
 
 namespace parlay {
 
+// Policy for pinning the workers of a scheduler to CPUs. CPUs are numbered
+// as by the OS, and only those that the process is allowed to run on are
+// used by the compact and scatter policies.
+//
+//  - none:     workers are not pinned, and run wherever the OS (or an external
+//              taskset or cgroup) places them
+//  - nodes:    workers are spread over the nodes in proportion to their number
+//              of CPUs, and each is confined to the CPUs of its node
+//  - compact:  worker i is pinned to the i'th CPU, filling one node before the next
+//  - scatter:  workers are pinned round-robin across the nodes
+//  - explicit: worker i is pinned to cpus[i % cpus.size()]. Use this to confine
+//              separate scheduler instances to disjoint sets of CPUs. The list
+//              must be nonempty, and only name CPUs the process may run on
+//
+// Workers are assigned CPUs cyclically if there are more workers than CPUs.
+// Worker 0 is the thread that created the scheduler. Under every policy other
+// than none, it is pinned while the scheduler is alive
+// (threads that it spawns in that time inherit its affinity), and restored
+// to its previous affinity afterwards. Pinning is only supported on Linux, and is
+// ignored on other platforms.
+struct affinity_policy {
+  enum class kind { none, nodes, compact, scatter, explicit_cpus };
+
+  kind policy{kind::none};
+  std::vector<unsigned int> cpus;
+
+  static affinity_policy none() { return {kind::none, {}}; }
+  static affinity_policy nodes() { return {kind::nodes, {}}; }
+  static affinity_policy compact() { return {kind::compact, {}}; }
+  static affinity_policy scatter() { return {kind::scatter, {}}; }
+  static affinity_policy explicit_cpus(std::vector<unsigned int> cpus_) {
+    return {kind::explicit_cpus, std::move(cpus_)};
+  }
+
+  // Parse a policy from a string, which is either "none", "nodes",
+  // "compact", "scatter", or a CPU list such as "0-3,8-11". Throws
+  // std::invalid_argument if the string is anything else.
+  static affinity_policy from_string(const std::string& s) {
+    if (s == "none") return none();
+    if (s == "nodes") return nodes();
+    if (s == "compact") return compact();
+    if (s == "scatter") return scatter();
+    if (!internal::is_cpu_list(s)) {
+      throw_exception_or_terminate<std::invalid_argument>("Unrecognized affinity policy \"" + s +
+          "\". Expected none, nodes, compact, scatter, or a CPU list such as 0-3,8-11");
+    }
+    return explicit_cpus(internal::parse_cpu_list(s));
+  }
+};
 
 template <typename Job>
 struct scheduler {
 
   using worker_id_type = unsigned int;
 
+  // Jobs are spawned at one of num_priorities priority levels, where higher
+  // levels are more urgent. Each worker keeps one deque per level, and
+  // thieves prefer to steal from the highest level that has active work.
+  static constexpr unsigned int num_priorities = 3;
+  static constexpr unsigned int normal_priority = 1;
+
  private:
   static_assert(std::is_invocable_r_v<void, Job&>);
 
@@ -64,9 +201,10 @@ struct scheduler {
 
     worker_id_type worker_id;
     scheduler* my_scheduler;
+    unsigned int level;         // The priority level of the job being executed
 
-    workerInfo() : worker_id(UNINITIALIZED), my_scheduler(nullptr) {}
-    workerInfo(std::size_t worker_id_, scheduler* s) : worker_id(worker_id_), my_scheduler(s) {}
+    workerInfo() : worker_id(UNINITIALIZED), my_scheduler(nullptr), level(normal_priority) {}
+    workerInfo(std::size_t worker_id_, scheduler* s) : worker_id(worker_id_), my_scheduler(s), level(normal_priority) {}
 
     workerInfo& operator=(const workerInfo&) = delete;
     workerInfo(const workerInfo&) = delete;
@@ -75,6 +213,7 @@ struct scheduler {
       if (this != &w) {
         worker_id = std::exchange(w.worker_id, UNINITIALIZED);
         my_scheduler = std::exchange(w.my_scheduler, nullptr);
+        level = std::exchange(w.level, normal_priority);
       }
       return *this;
     }
@@ -82,12 +221,6 @@ struct scheduler {
     workerInfo(workerInfo&& w) noexcept { *this = std::move(w); }
   };
 
-  // After YIELD_FACTOR * P unsuccessful steal attempts, a
-  // a worker will sleep briefly for SLEEP_FACTOR * P nanoseconds
-  // to give other threads a chance to work and save some cycles.
-  constexpr static size_t YIELD_FACTOR = 200;
-  constexpr static size_t SLEEP_FACTOR = 200;
-
   // The length of time that a worker must fail to steal anything
   // before it goes to sleep to save CPU time.
   constexpr static std::chrono::microseconds STEAL_TIMEOUT{PARLAY_ELASTIC_STEAL_TIMEOUT};
@@ -104,20 +237,39 @@ struct scheduler {
     return worker_info.my_scheduler;
   }
 
-  explicit scheduler(size_t num_workers)
+  explicit scheduler(size_t num_workers, affinity_policy affinity = affinity_policy::none())
       : num_threads(num_workers),
         num_deques(num_threads),
-        num_awake_workers(num_threads),
         parent_worker_info(std::exchange(worker_info, workerInfo{0, this})),
-        deques(num_deques),
+        deques(num_priorities * num_deques),
         attempts(num_deques),
+#if PARLAY_SCHEDULER_STATS
+        counters(num_deques),
+#endif
+#if PARLAY_SCHEDULER_TRACE
+        trace_flags(num_deques),
+#endif
         spawned_threads(),
         finished_flag(false) {
 
+    if (auto error = check_affinity(affinity); !error.empty()) {
+      worker_info = std::move(parent_worker_info);
+      throw_exception_or_terminate<std::invalid_argument>(error);
+    }
+    assign_workers(affinity);
+
+    // The creating thread is worker 0, so it is pinned for the lifetime
+    // of the scheduler and then restored to its previous affinity
+    if (!worker_cpus[0].empty()) {
+      parent_cpus = internal::current_thread_cpus();
+      pin_current_thread(worker_cpus[0]);
+    }
+
     // Spawn num_threads many threads on startup
     for (worker_id_type i = 1; i < num_threads; ++i) {
       spawned_threads.emplace_back([&, i]() {
         worker_info = {i, this};
+        if (!worker_cpus[i].empty()) pin_current_thread(worker_cpus[i]);
         worker();
       });
     }
@@ -125,18 +277,48 @@ struct scheduler {
 
   ~scheduler() {
     shutdown();
+    if (!parent_cpus.empty()) internal::bind_current_thread_to_cpus(parent_cpus);
     worker_info = std::move(parent_worker_info);
   }
 
   // Push onto local stack.
   void spawn(Job* job) {
     int id = worker_id();
-    [[maybe_unused]] bool first = deques[id].push_bottom(job);
+    auto& q = deque(worker_info.level, id);
+    [[maybe_unused]] bool first = q.push_bottom(job);
+#if PARLAY_SCHEDULER_STATS
+    counters[id].update_high_water(q.size());
+#endif
 #if PARLAY_ELASTIC_PARALLELISM
     if (first) wake_up_a_worker();
 #endif
   }
 
+  // Push onto local stack, unless that would use more than half of its
+  // capacity, which is kept for the nested forks of the jobs. Returns false
+  // if the job was not pushed, in which case the caller should run it.
+  // Always succeeds with growable deques.
+  bool try_spawn(Job* job) {
+    int id = worker_id();
+    if (!deque(worker_info.level, id).has_room(internal::Deque<Job>::q_size / 2)) return false;
+    spawn(job);
+    return true;
+  }
+
+  // Submit a job from any thread, including threads that are not workers of
+  // this scheduler. Injected jobs are picked up by workers looking for work
+  // to steal, and run at normal priority.
+  void inject(Job* job) {
+    {
+      std::lock_guard<std::mutex> lock(injected_mutex);
+      injected_jobs.push(job);
+      num_injected.fetch_add(1, std::memory_order_release);
+    }
+#if PARLAY_ELASTIC_PARALLELISM
+    wake_up_a_worker();
+#endif
+  }
+
   // Wait until the given condition is true.
   //
   // If conservative, this thread will simply busy wait. Otherwise,
@@ -161,16 +343,105 @@ struct scheduler {
   // Pop from local stack.
   Job* get_own_job() {
     auto id = worker_id();
-    return deques[id].pop_bottom();
+    Job* job = deque(worker_info.level, id).pop_bottom();
+#if PARLAY_SCHEDULER_STATS
+    if (job) counters[id].add(counters[id].jobs_executed, size_t{1});
+#endif
+    return job;
+  }
+
+  // Run f() with the jobs that it spawns at the given priority level. While
+  // f() is running, idle workers prefer to steal its jobs over jobs of lower
+  // levels, and workers running lower-level jobs check for its jobs at every
+  // fork, so it is not stuck behind large amounts of less urgent work.
+  template <typename F>
+  void run_with_priority(unsigned int level, F&& f) {
+    assert(level < num_priorities);
+    auto old_level = std::exchange(worker_info.level, level);
+    active_roots[level].fetch_add(1, std::memory_order_relaxed);
+    // Deactivates the level and restores the old one even if f() throws
+    struct level_guard {
+      std::atomic<size_t>& roots;
+      unsigned int old_level;
+      ~level_guard() {
+        roots.fetch_sub(1, std::memory_order_relaxed);
+        worker_info.level = old_level;
+      }
+    } guard{active_roots[level], old_level};
+    std::forward<F>(f)();
+  }
+
+  // If any jobs of a higher priority than the current one are active, try
+  // once to steal and run one of them. Called by the fork-join scheduler
+  // at every fork so that low priority jobs are preempted at fork points.
+  void yield_to_higher_priority() {
+    for (unsigned int level = num_priorities - 1; level > worker_info.level; level--) {
+      if (active_roots[level].load(std::memory_order_relaxed) > 0) {
+        size_t id = worker_id();
+        if (Job* job = deque(level, steal_target(id)).pop_top().first; job != nullptr) {
+          run_job(job, level);
+        }
+        return;
+      }
+    }
   }
 
   worker_id_type num_workers() { return num_threads; }
   worker_id_type worker_id() { return worker_info.worker_id; }
+  unsigned int priority_level() { return worker_info.level; }
+
+  // The number of NUMA nodes that the workers are spread over, the node
+  // of the current worker, and the number of workers on a given node.
+  // Without NUMA awareness, all workers are considered to be on node 0.
+  size_t num_numa_nodes() const { return node_workers.size(); }
+  size_t numa_node_id() { return worker_node[worker_id()]; }
+  size_t num_workers_on_node(size_t node) const {
+    return node < node_workers.size() ? node_workers[node].size() : 0;
+  }
 
   bool finished() const noexcept {
     return finished_flag.load(std::memory_order_acquire);
   }
 
+  // A snapshot of the statistics of each worker. Empty unless the
+  // scheduler was compiled with PARLAY_SCHEDULER_STATS.
+  scheduler_statistics statistics() const {
+    scheduler_statistics result;
+#if PARLAY_SCHEDULER_STATS
+    for (const auto& c : counters) result.workers.push_back(c.snapshot());
+#endif
+    return result;
+  }
+
+  void reset_statistics() {
+#if PARLAY_SCHEDULER_STATS
+    for (auto& c : counters) c.reset();
+#endif
+  }
+
+  // Send events to the given recorder from now on, or stop sending them if
+  // it is null. Returns once no worker can still be using the previous
+  // recorder, so it can then be destroyed. Has no effect unless compiled
+  // with PARLAY_SCHEDULER_TRACE.
+  void set_trace_recorder([[maybe_unused]] internal::trace_recorder* new_recorder) {
+#if PARLAY_SCHEDULER_TRACE
+    recorder.store(new_recorder, std::memory_order_seq_cst);
+    for (auto& f : trace_flags) {
+      while (f.busy.load(std::memory_order_seq_cst)) std::this_thread::yield();
+    }
+#endif
+  }
+
+  // Report an event of the current worker to the active recorder, if any
+  void trace([[maybe_unused]] internal::trace_event_type type, [[maybe_unused]] size_t arg = 0) {
+#if PARLAY_SCHEDULER_TRACE
+    size_t id = worker_id();
+    trace_flags[id].busy.store(true, std::memory_order_seq_cst);
+    if (auto r = recorder.load(std::memory_order_seq_cst)) r->record(id, type, arg);
+    trace_flags[id].busy.store(false, std::memory_order_release);
+#endif
+  }
+
  private:
   // Align to avoid false sharing.
   struct alignas(128) attempt {
@@ -178,14 +449,41 @@ struct scheduler {
   };
 
   int num_deques;
-  std::atomic<size_t> num_awake_workers;
   workerInfo parent_worker_info;
-  std::vector<internal::Deque<Job>> deques;
+#if PARLAY_GROWABLE_DEQUE
+  using deque_type = internal::growable_deque<Job>;
+#else
+  using deque_type = internal::Deque<Job>;
+#endif
+
+  std::vector<deque_type> deques;
   std::vector<attempt> attempts;
+#if PARLAY_SCHEDULER_STATS
+  std::vector<internal::worker_counters> counters;
+#endif
+#if PARLAY_SCHEDULER_TRACE
+  // Set by a worker while it may be using the recorder
+  struct alignas(128) trace_flag {
+    std::atomic<bool> busy{false};
+  };
+  std::atomic<internal::trace_recorder*> recorder{nullptr};
+  std::vector<trace_flag> trace_flags;
+#endif
+  std::atomic<size_t> active_roots[num_priorities]{};
+  std::mutex injected_mutex;
+  std::queue<Job*> injected_jobs;
+  std::atomic<size_t> num_injected{0};
+  std::vector<unsigned int> worker_node;
+  std::vector<std::vector<worker_id_type>> node_workers;
+  std::vector<std::vector<unsigned int>> worker_cpus;
+  std::vector<unsigned int> parent_cpus;
+  bool numa_stealing{false};
   std::vector<std::thread> spawned_threads;
   std::atomic<int> finished_flag;
 
-  std::atomic<size_t> wake_up_counter{0};
+#if PARLAY_ELASTIC_PARALLELISM
+  internal::eventcount sleeping_workers;
+#endif
   std::atomic<size_t> num_finished_workers{0};
 
   // Start an individual worker task, stealing work if no local
@@ -197,8 +495,9 @@ struct scheduler {
     wait_for_work();
 #endif
     while (!finished()) {
-      Job* job = get_job([&]() { return finished(); }, PARLAY_ELASTIC_PARALLELISM);
-      if (job)(*job)();
+      unsigned int level = worker_info.level;
+      Job* job = get_job([&]() { return finished(); }, PARLAY_ELASTIC_PARALLELISM, level);
+      if (job) run_job(job, level);
 #if PARLAY_ELASTIC_PARALLELISM
       else if (!finished()) {
         // If no job was stolen, the worker should go to
@@ -221,24 +520,39 @@ struct scheduler {
   template <typename F>
   void do_work_until(F&& done) {
     while (true) {
-      Job* job = get_job(done, false);  // timeout MUST BE false
+      unsigned int level = worker_info.level;
+      Job* job = get_job(done, false, level);  // timeout MUST BE false
       if (!job) return;
-      (*job)();
+      run_job(job, level);
     }
     assert(done());
   }
 
+  // Run a job at the priority level of the deque that it came from
+  void run_job(Job* job, unsigned int level) {
+    auto old_level = std::exchange(worker_info.level, level);
+    trace(internal::trace_event_type::job_begin, level);
+    (*job)();
+    trace(internal::trace_event_type::job_end);
+    worker_info.level = old_level;
+  }
+
+  deque_type& deque(unsigned int level, size_t id) {
+    return deques[level * num_deques + id];
+  }
+
   // Find a job, first trying local stack, then random steals.
   //
   // Returns nullptr if break_early() returns true before a job
   // is found, or, if timeout is true and it takes longer than
-  // STEAL_TIMEOUT to find a job to steal.
+  // STEAL_TIMEOUT to find a job to steal. Sets level to the
+  // priority level of the job that was found.
   template <typename F>
-  Job* get_job(F&& break_early, bool timeout) {
+  Job* get_job(F&& break_early, bool timeout, unsigned int& level) {
     if (break_early()) return nullptr;
     Job* job = get_own_job();
     if (job) return job;
-    else job = steal_job(std::forward<F>(break_early), timeout);
+    else job = steal_job(std::forward<F>(break_early), timeout, level);
     return job;
   }
   
@@ -248,56 +562,290 @@ struct scheduler {
   // is found, or, if timeout is true and it takes longer than
   // STEAL_TIMEOUT to find a job to steal.
   template<typename F>
-  Job* steal_job(F&& break_early, bool timeout) {
+  Job* steal_job(F&& break_early, bool timeout, unsigned int& level) {
     size_t id = worker_id();
     const auto start_time = std::chrono::steady_clock::now();
+#if PARLAY_SCHEDULER_STATS
+    struct steal_timer {
+      internal::worker_counters& c;
+      std::chrono::steady_clock::time_point start;
+      ~steal_timer() { c.add(c.steal_ns, internal::worker_counters::since(start)); }
+    } timer{counters[id], start_time};
+#endif
+    size_t round = 0;
     do {
       // By coupon collector's problem, this should touch all.
-      for (size_t i = 0; i <= YIELD_FACTOR * num_deques; i++) {
+      for (size_t i = 0; i <= size_t{PARLAY_STEAL_ATTEMPTS_PER_WORKER} * num_deques; i++) {
         if (break_early()) return nullptr;
-        Job* job = try_steal(id);
+        Job* job = try_steal(id, level);
         if (job) return job;
       }
-      std::this_thread::sleep_for(std::chrono::nanoseconds(num_deques * 100));
+      if (round++ < PARLAY_STEAL_SPIN_ROUNDS) std::this_thread::yield();
+      else std::this_thread::sleep_for(std::chrono::nanoseconds(num_deques * PARLAY_STEAL_BACKOFF_NS));
     } while (!timeout || std::chrono::steady_clock::now() - start_time < STEAL_TIMEOUT);
     return nullptr;
   }
 
-  Job* try_steal(size_t id) {
-    // use hashing to get "random" target
-    size_t target = (hash(id) + hash(attempts[id].val)) % num_deques;
-    attempts[id].val++;
-    auto [job, empty] = deques[target].pop_top();
+  // Try to steal from a victim, trying its deques from the highest priority
+  // level down. Levels other than normal are skipped if they have no active
+  // work, so without prioritized work, this is a single attempt.
+  Job* try_steal(size_t id, unsigned int& level) {
+    if (Job* job = take_injected_job()) {
+      level = normal_priority;
+#if PARLAY_SCHEDULER_STATS
+      counters[id].add(counters[id].jobs_executed, size_t{1});
+#endif
+      return job;
+    }
+    size_t target = steal_target(id);
+    for (unsigned int l = num_priorities; l-- > 0;) {
+      if (l != normal_priority && active_roots[l].load(std::memory_order_relaxed) == 0) continue;
+#if PARLAY_GROWABLE_DEQUE
+      // Run the oldest of the stolen jobs, and keep the others on our own
+      // deque, where they can be stolen again
+      Job* batch[deque_type::max_steal];
+      auto [count, empty] = deque(l, target).pop_top_batch(batch, deque_type::max_steal);
+      Job* job = count > 0 ? batch[0] : nullptr;
+      for (size_t i = 1; i < count; i++) deque(l, id).push_bottom(batch[i]);
+#if PARLAY_SCHEDULER_STATS
+      if (count > 1) counters[id].update_high_water(deque(l, id).size());
+#endif
 #if PARLAY_ELASTIC_PARALLELISM
-    if (!empty) wake_up_a_worker();
+      if (!empty || count > 1) wake_up_a_worker();
 #endif
+#else
+      auto [job, empty] = deque(l, target).pop_top();
+#if PARLAY_ELASTIC_PARALLELISM
+      if (!empty) wake_up_a_worker();
+#endif
+#endif
+      if (job) {
+        level = l;
+        trace(internal::trace_event_type::steal, target);
+#if PARLAY_SCHEDULER_STATS
+        counters[id].add(counters[id].steals, size_t{1});
+        counters[id].add(counters[id].jobs_executed, size_t{1});
+#endif
+        return job;
+      }
+    }
+#if PARLAY_SCHEDULER_STATS
+    counters[id].add(counters[id].failed_steals, size_t{1});
+#endif
+    return nullptr;
+  }
+
+  Job* take_injected_job() {
+    if (num_injected.load(std::memory_order_acquire) == 0) return nullptr;
+    std::lock_guard<std::mutex> lock(injected_mutex);
+    if (injected_jobs.empty()) return nullptr;
+    Job* job = injected_jobs.front();
+    injected_jobs.pop();
+    num_injected.fetch_sub(1, std::memory_order_relaxed);
     return job;
   }
 
+  // Choose a victim to steal from, using hashing to get a "random" target.
+  //
+  // If NUMA-aware and the workers are pinned, each round of attempts makes
+  // 2 * (workers on the node) attempts on the worker's own node, followed
+  // by a bounded number of attempts on any worker, so that work only
+  // crosses the interconnect when the local node is likely to have run out.
+  size_t steal_target(size_t id) {
+    size_t r = hash(id) + hash(attempts[id].val);
+    [[maybe_unused]] size_t attempt = attempts[id].val++;
+#if PARLAY_NUMA_AWARE
+    if (numa_stealing) {
+      const auto& local = node_workers[worker_node[id]];
+      size_t local_attempts = 2 * local.size();
+      if (attempt % (local_attempts + PARLAY_NUMA_REMOTE_STEAL_ATTEMPTS) < local_attempts) {
+        return local[r % local.size()];
+      }
+    }
+#endif
+    return r % num_deques;
+  }
+
+  // Pin the calling worker to the given CPUs, and warn if that fails on a
+  // platform that supports pinning
+  void pin_current_thread(const std::vector<unsigned int>& cpus) {
+    [[maybe_unused]] bool pinned = internal::bind_current_thread_to_cpus(cpus);
+#if defined(__linux__)
+    if (!pinned) std::cerr << "Warning: could not pin worker " << worker_id() << " to its CPUs\n";
+#endif
+  }
+
+  // Returns a description of what is wrong with the given policy, or an
+  // empty string if it can be used. An explicit list of CPUs must be
+  // nonempty, and only name CPUs that the process is allowed to run on.
+  static std::string check_affinity(const affinity_policy& affinity) {
+    if (affinity.policy != affinity_policy::kind::explicit_cpus) return {};
+    if (affinity.cpus.empty()) return "Explicit affinity policy with no CPUs";
+    auto allowed = internal::allowed_cpus();
+    if (allowed.empty()) return {};
+    for (unsigned int cpu : affinity.cpus) {
+      if (!std::binary_search(allowed.begin(), allowed.end(), cpu)) {
+        return "Explicit affinity policy names CPU " + std::to_string(cpu) +
+               ", which the process is not allowed to run on";
+      }
+    }
+    return {};
+  }
+
+  // Assign each worker the set of CPUs that it will be pinned to, and
+  // the NUMA node that it belongs to
+  void assign_workers(const affinity_policy& affinity) {
+    auto placement = place_workers(num_threads, affinity, internal::get_numa_topology());
+    worker_node = std::move(placement.worker_node);
+    worker_cpus = std::move(placement.worker_cpus);
+    node_workers = std::move(placement.node_workers);
+    numa_stealing = placement.numa_stealing;
+  }
+
+ public:
+
+  struct worker_placement {
+    std::vector<unsigned int> worker_node;
+    std::vector<std::vector<unsigned int>> worker_cpus;
+    std::vector<std::vector<worker_id_type>> node_workers;
+    bool numa_stealing{false};
+  };
+
+  // Place num_workers workers on the given topology under the given policy.
+  //
+  // Without a pinning policy, or under the nodes policy, workers are
+  // spread over the CPUs in node order, so each node gets a share of the
+  // workers proportional to its number of CPUs. Only the nodes policy
+  // confines them to the CPUs of their node. Otherwise, the node of each
+  // worker is the node of the CPU that it is pinned to.
+  //
+  // Thieves prefer victims on their own node only if the workers span
+  // several nodes and are bound to them. Under the none policy, the OS may
+  // run a worker anywhere, so its nominal node says nothing about where
+  // its data is, and preferring it would only narrow the choice of victims.
+  static worker_placement place_workers(size_t num_workers, const affinity_policy& affinity,
+                                        const internal::numa_topology& topology) {
+    size_t num_nodes = topology.num_nodes();
+
+    std::vector<unsigned int> cpu_list, cpu_node;
+    for (unsigned int node = 0; node < num_nodes; node++) {
+      cpu_list.insert(cpu_list.end(), topology.node_cpus[node].begin(), topology.node_cpus[node].end());
+      cpu_node.insert(cpu_node.end(), topology.node_cpus[node].size(), node);
+    }
+    size_t num_cpus = cpu_list.size();
+
+    auto node_of = [&](unsigned int cpu) -> unsigned int {
+      for (size_t j = 0; j < num_cpus; j++) {
+        if (cpu_list[j] == cpu) return cpu_node[j];
+      }
+      return 0;
+    };
+
+    worker_placement result;
+    auto& worker_node = result.worker_node;
+    auto& worker_cpus = result.worker_cpus;
+    auto& node_workers = result.node_workers;
+    worker_node.assign(num_workers, 0);
+    worker_cpus.assign(num_workers, {});
+    for (size_t i = 0; i < num_workers; i++) {
+      switch (affinity.policy) {
+        case affinity_policy::kind::none:
+        case affinity_policy::kind::nodes: {
+          size_t cpu = (num_workers <= num_cpus) ? i * num_cpus / num_workers : i % num_cpus;
+          worker_node[i] = cpu_node[cpu];
+          if (affinity.policy == affinity_policy::kind::nodes) worker_cpus[i] = topology.node_cpus[worker_node[i]];
+          break;
+        }
+        case affinity_policy::kind::compact: {
+          worker_cpus[i] = {cpu_list[i % num_cpus]};
+          worker_node[i] = cpu_node[i % num_cpus];
+          break;
+        }
+        case affinity_policy::kind::scatter: {
+          unsigned int node = i % num_nodes;
+          const auto& cpus = topology.node_cpus[node];
+          worker_cpus[i] = {cpus[(i / num_nodes) % cpus.size()]};
+          worker_node[i] = node;
+          break;
+        }
+        case affinity_policy::kind::explicit_cpus: {
+          unsigned int cpu = affinity.cpus[i % affinity.cpus.size()];
+          worker_cpus[i] = {cpu};
+          worker_node[i] = node_of(cpu);
+          break;
+        }
+      }
+    }
+
+#if PARLAY_NUMA_AWARE
+    node_workers.resize(num_nodes);
+    for (worker_id_type i = 0; i < num_workers; i++) {
+      node_workers[worker_node[i]].push_back(i);
+    }
+    result.numa_stealing = affinity.policy != affinity_policy::kind::none &&
+        std::count_if(node_workers.begin(), node_workers.end(), [](const auto& w) { return !w.empty(); }) > 1;
+#else
+    worker_node.assign(num_workers, 0);
+    node_workers.resize(1);
+    for (worker_id_type i = 0; i < num_workers; i++) {
+      node_workers[0].push_back(i);
+    }
+#endif
+    return result;
+  }
+
+ private:
+
 #if PARLAY_ELASTIC_PARALLELISM
 
-  // Wakes up at least one sleeping worker (more than one
-  // worker may be woken up depending on the implementation).
+  // Wakes up a sleeping worker, if there are any. Workers that were about
+  // to fall asleep may wake up as well. The eventcount's fence orders the
+  // push of the new work before its check for waiters, so it must be
+  // notified unconditionally. It costs a single load when nobody waits.
   void wake_up_a_worker() {
-    if (num_awake_workers.load(std::memory_order_acquire) < num_threads) {
-      wake_up_counter.fetch_add(1);
-      parlay::atomic_notify_one(&wake_up_counter);
-    }
+    sleeping_workers.notify_one();
   }
-  
+
   // Wake up all sleeping workers
   void wake_up_all_workers() {
-    if (num_awake_workers.load(std::memory_order_acquire) < num_threads) {
-      wake_up_counter.fetch_add(1);
-      parlay::atomic_notify_all(&wake_up_counter);
+    sleeping_workers.notify_all();
+  }
+
+  // True if the injection queue, or any deque that thieves may steal
+  // from, has a job. Like try_steal, skips levels other than normal that
+  // have no active roots, since jobs left on them (e.g., un-waited futures
+  // spawned in an execute_with_priority scope) can not be stolen until a
+  // root at their level is active again. Checked by workers after
+  // announcing that they are going to sleep, so that work that was pushed
+  // just before they announced it does not go unnoticed.
+  bool work_available() {
+    if (num_injected.load(std::memory_order_acquire) > 0) return true;
+    // The deque is read first, so that a job seen there was pushed after
+    // its root was counted
+    for (unsigned int l = 0; l < num_priorities; l++) {
+      for (int id = 0; id < num_deques; id++) {
+        if (deque(l, id).maybe_nonempty() &&
+            (l == normal_priority || active_roots[l].load(std::memory_order_relaxed) > 0)) return true;
+      }
     }
+    return false;
   }
-  
+
   // Wait until notified to wake up
   void wait_for_work() {
-    num_awake_workers.fetch_sub(1);
-    parlay::atomic_wait(&wake_up_counter, wake_up_counter.load());
-    num_awake_workers.fetch_add(1);
+#if PARLAY_SCHEDULER_STATS
+    auto& c = counters[worker_id()];
+    c.add(c.sleeps, size_t{1});
+    auto start = std::chrono::steady_clock::now();
+#endif
+    trace(internal::trace_event_type::sleep_begin);
+    auto key = sleeping_workers.prepare_wait();
+    if (finished() || work_available()) sleeping_workers.cancel_wait();
+    else sleeping_workers.wait(key);
+    trace(internal::trace_event_type::sleep_end);
+#if PARLAY_SCHEDULER_STATS
+    c.add(c.sleep_ns, internal::worker_counters::since(start));
+#endif
   }
 
 #endif
@@ -337,32 +885,81 @@ class fork_join_scheduler {
   template <typename L, typename R>
   static void pardo(scheduler_t& scheduler, L&& left, R&& right, bool conservative = false) {
     auto execute_right = [&]() { std::forward<R>(right)(); };
-    auto right_job = make_job(right);
+    // If right is stolen, it allocates from the same arena as the fork
+    auto run_right = [&, arena = internal::current_arena()]() {
+      // Restores the thief's arena even if right() throws
+      struct arena_guard {
+        parlay::arena* outer;
+        ~arena_guard() { internal::current_arena() = outer; }
+      } guard{std::exchange(internal::current_arena(), arena)};
+      std::forward<R>(right)();
+    };
+    auto right_job = make_job(run_right);
     scheduler.spawn(&right_job);
+    if (!conservative) scheduler.yield_to_higher_priority();
     std::forward<L>(left)();
-    if (const Job* job = scheduler.get_own_job(); job != nullptr) {
-      assert(job == &right_job);
-      execute_right();
-    }
-    else {
-      auto done = [&]() { return right_job.finished(); };
-      scheduler.wait_until(done, conservative);
-      assert(right_job.finished());
+    // Jobs that left() spawned without waiting for them (e.g., futures) were
+    // pushed after right_job, so they are popped first. Thieves take the
+    // oldest jobs first, so if right_job was stolen, so were the older jobs
+    // of the enclosing forks, and this never runs a job that belongs to an
+    // enclosing fork.
+    while (Job* job = scheduler.get_own_job()) {
+      scheduler.trace(internal::trace_event_type::job_begin, scheduler.priority_level());
+      if (job == &right_job) {
+        execute_right();
+        scheduler.trace(internal::trace_event_type::job_end);
+        return;
+      }
+      (*job)();
+      scheduler.trace(internal::trace_event_type::job_end);
     }
+    auto done = [&]() { return right_job.finished(); };
+    scheduler.wait_until(done, conservative);
+    assert(right_job.finished());
   }
 
   template <typename F>
   static void parfor(scheduler_t& scheduler, size_t start, size_t end, F&& f, size_t granularity = 0, bool conservative = false) {
     if (end <= start) return;
     if (granularity == 0) {
+#if PARLAY_ADAPTIVE_GRANULARITY
+      auto& controller = internal::granularity_controller_for<std::decay_t<F>>();
+      parfor(scheduler, start, end, f, controller, conservative);
+      return;
+#else
       size_t done = get_granularity(start, end, f);
       granularity = std::max(done, (end - start) / static_cast<size_t>(128 * scheduler.num_threads));
       start += done;
+#endif
     }
     parfor_(scheduler, start, end, f, granularity, conservative);
   }
 
+  // Parallel loop whose granularity is given by the controller. Only the
+  // first call with a given controller times a sequential prefix. After
+  // that, the leftmost leaf of every call is timed to refine the estimate.
+  template <typename F>
+  static void parfor(scheduler_t& scheduler, size_t start, size_t end, F&& f,
+                     granularity_controller& controller, bool conservative = false) {
+    if (end <= start) return;
+    if (!controller.calibrated()) {
+      auto tstart = std::chrono::steady_clock::now();
+      size_t done = get_granularity(start, end, f);
+      controller.record(done, elapsed_ns(tstart));
+      start += done;
+      if (start == end) return;
+    }
+    size_t granularity = std::max(controller.granularity(),
+        (end - start) / static_cast<size_t>(128 * scheduler.num_threads));
+    parfor_(scheduler, start, end, f, granularity, conservative, &controller);
+  }
+
  private:
+  static unsigned long long int elapsed_ns(std::chrono::steady_clock::time_point tstart) {
+    return static_cast<unsigned long long int>(std::chrono::duration_cast<
+             std::chrono::nanoseconds>(std::chrono::steady_clock::now() - tstart).count());
+  }
+
   template <typename F>
   static size_t get_granularity(size_t start, size_t end, F& f) {
     size_t done = 0;
@@ -382,15 +979,25 @@ class fork_join_scheduler {
   }
 
   template <typename F>
-  static void parfor_(scheduler_t& scheduler, size_t start, size_t end, F& f, size_t granularity, bool conservative) {
-    if ((end - start) <= granularity)
-      for (size_t i = start; i < end; i++) f(i);
+  static void parfor_(scheduler_t& scheduler, size_t start, size_t end, F& f, size_t granularity, bool conservative,
+                      granularity_controller* sample = nullptr) {
+    if ((end - start) <= granularity) {
+      if (sample) {
+        // Only the leftmost leaf is sampled, so a loop reads the clock twice
+        auto tstart = std::chrono::steady_clock::now();
+        for (size_t i = start; i < end; i++) f(i);
+        sample->record(end - start, elapsed_ns(tstart));
+      }
+      else {
+        for (size_t i = start; i < end; i++) f(i);
+      }
+    }
     else {
       size_t n = end - start;
       // Not in middle to avoid clashes on set-associative caches on powers of 2.
       size_t mid = (start + (9 * (n + 1)) / 16);
       pardo(scheduler,
-            [&]() { parfor_(scheduler, start, mid, f, granularity, conservative); },
+            [&]() { parfor_(scheduler, start, mid, f, granularity, conservative, sample); },
             [&]() { parfor_(scheduler, mid, end, f, granularity, conservative); },
             conservative);
     }
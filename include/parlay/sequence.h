@@ -4,7 +4,7 @@
 // Parlay sequences also support optional small-size optimization, where short sequences of trivial
 // types are stored inline in the object rather than allocated on the heap. By default, small-size
 // optimization is not enabled. A type alias, short_sequence, is provided, that turns on small-size
-// optimization.
+// optimization, and another, small_sequence, that also sets how many elements are stored inline.
 //
 
 #ifndef PARLAY_SEQUENCE_H_
@@ -65,9 +65,12 @@ using sequence_default_allocator = std::allocator<T>;
 //  T:          the value type of the sequence
 //  Allocator:  an allocator for type T
 //  EnableSSO:  true to enable small-size optimization
+//  InlineCapacity: with small-size optimization, the number of elements to store inline,
+//                  or 0 for as many as fit in 15 bytes (see small_sequence)
 //
-template<typename T, typename Allocator = internal::sequence_default_allocator<T>, bool EnableSSO = std::is_same<T, char>::value>
-class PARLAY_TRIVIALLY_RELOCATABLE sequence : protected sequence_internal::sequence_base<T, Allocator, EnableSSO> {
+template<typename T, typename Allocator = internal::sequence_default_allocator<T>,
+         bool EnableSSO = std::is_same<T, char>::value, size_t InlineCapacity = 0>
+class PARLAY_TRIVIALLY_RELOCATABLE sequence : protected sequence_internal::sequence_base<T, Allocator, EnableSSO, InlineCapacity> {
 
   static_assert(std::is_same_v<typename std::remove_cv_t<T>, T>, "sequences must have a non-const, non-volatile value_type");
   static_assert(std::is_same_v<typename std::decay_t<T>, T>, "sequences must not have an array, reference, or function value_type");
@@ -94,8 +97,8 @@ class PARLAY_TRIVIALLY_RELOCATABLE sequence : protected sequence_internal::seque
   using view_type = slice<iterator, iterator>;
   using const_view_type = slice<const_iterator, const_iterator>;
 
-  using sequence_type = sequence<T, Allocator, EnableSSO>;
-  using sequence_base_type = sequence_internal::sequence_base<T, Allocator, EnableSSO>;
+  using sequence_type = sequence<T, Allocator, EnableSSO, InlineCapacity>;
+  using sequence_base_type = sequence_internal::sequence_base<T, Allocator, EnableSSO, InlineCapacity>;
   using allocator_type = Allocator;
 
   using sequence_base_type::storage;
@@ -691,12 +694,12 @@ class PARLAY_TRIVIALLY_RELOCATABLE sequence : protected sequence_internal::seque
 // Mark sequences as trivially relocatable. A sequence is always
 // trivially relocatable as long as the allocator is, because:
 //  1) Sequences only use small-size optimization when the element
-//     type is trivial, so the buffer of trivial elements is
-//     trivially relocatable.
+//     type is trivially relocatable, so the buffer of inline elements
+//     is trivially relocatable.
 //  2) Sequences that are not small-size optimized are just a
 //     pointer/length pair, which are trivially relocatable
-template<typename T, typename Alloc, bool EnableSSO>
-PARLAY_ASSUME_TRIVIALLY_RELOCATABLE_IF((is_trivially_relocatable_v<Alloc>), parlay::sequence<T, Alloc, EnableSSO>);
+template<typename T, typename Alloc, bool EnableSSO, size_t InlineCapacity>
+PARLAY_ASSUME_TRIVIALLY_RELOCATABLE_IF((is_trivially_relocatable_v<Alloc>), parlay::sequence<T, Alloc, EnableSSO, InlineCapacity>);
 
 #endif
 
@@ -714,6 +717,21 @@ PARLAY_ASSUME_TRIVIALLY_RELOCATABLE_IF((is_trivially_relocatable_v<Alloc>), parl
 template<typename T, typename Allocator = internal::sequence_default_allocator<T>>
 using short_sequence = sequence<T, Allocator, true>;
 
+// A small_sequence is a sequence that stores up to N elements inline, without
+// a heap allocation, e.g., the adjacency lists of a graph whose vertices have
+// low degree:
+//    parlay::sequence<parlay::small_sequence<vertex, 6>> graph;
+//
+// Unlike short_sequence, the elements need not be trivial, only trivially
+// relocatable (e.g., sequences of sequences), and at most 8-byte aligned;
+// otherwise every element is stored on the heap. The sequence object is
+// N * sizeof(T) + 1 bytes rounded up to a multiple of 8 (and at least 16),
+// and any slack is used for more inline elements. N can be at most 127.
+//
+// This type is just an alias for parlay::sequence<T, Allocator, true, N>
+template<typename T, size_t N, typename Allocator = internal::sequence_default_allocator<T>>
+using small_sequence = sequence<T, Allocator, true, N>;
+
 // A chars is an alias for a short-size optimized character sequence.
 //
 // You can think of chars as either an abbreviation of "char sequence",
@@ -770,9 +788,9 @@ inline auto to_short_sequence(R&& r) -> short_sequence<T, Alloc> {
 namespace std {
 
 // compute a suitable hash value for a sequence
-template<typename T, typename Allocator, bool EnableSSO>
-struct hash<parlay::sequence<T, Allocator, EnableSSO>> {
-  std::size_t operator()(parlay::sequence<T, Allocator, EnableSSO> const& s) const noexcept {
+template<typename T, typename Allocator, bool EnableSSO, size_t InlineCapacity>
+struct hash<parlay::sequence<T, Allocator, EnableSSO, InlineCapacity>> {
+  std::size_t operator()(parlay::sequence<T, Allocator, EnableSSO, InlineCapacity> const& s) const noexcept {
     size_t hash = 5381;
       for (size_t i = 0; i < s.size(); i++) {
         hash = ((hash << 5) + hash) + parlay::hash<T>{}(s[i]);
@@ -0,0 +1,205 @@
+#ifndef PARLAY_TRACE_H_
+#define PARLAY_TRACE_H_
+
+#include <cstddef>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "parallel.h"
+#include "worker_specific.h"
+
+#include "internal/trace_recorder.h"
+
+// ----------------------------------------------------------------------------
+// Timeline of the execution of the scheduler, for finding out why a parallel
+// algorithm does not speed up. While a scheduler_trace is recording, each
+// worker logs when it begins and ends every job it runs, every successful
+// steal, and when it goes to sleep, into its own ring buffer. The trace can
+// then be written in the Chrome trace event format, which can be viewed with
+// chrome://tracing or https://ui.perfetto.dev.
+//
+//    parlay::scheduler_trace trace;
+//    parlay::sort_inplace(a);
+//    trace.write_chrome_trace("sort.json");
+//
+// Each ring buffer keeps the most recent events of its worker, so long runs
+// only show their end. Events are only recorded if Parlay is compiled with
+// PARLAY_SCHEDULER_TRACE and uses its own scheduler. Otherwise, traces are
+// empty.
+// ----------------------------------------------------------------------------
+
+namespace parlay {
+
+namespace internal {
+
+struct trace_event {
+  long long time_ns;          // since the trace started
+  size_t arg;
+  trace_event_type type;
+};
+
+// A single-producer ring buffer that overwrites its oldest events
+class trace_ring {
+ public:
+  explicit trace_ring(size_t capacity) {
+    size_t c = 1;
+    while (c < capacity) c *= 2;
+    events = std::make_unique<trace_event[]>(c);
+    mask = c - 1;
+  }
+
+  void push(const trace_event& event) noexcept {
+    auto h = head.load(std::memory_order_relaxed);
+    events[h & mask] = event;
+    head.store(h + 1, std::memory_order_release);
+  }
+
+  // The events still in the buffer, oldest first. Only consistent if
+  // the producer is not pushing concurrently.
+  [[nodiscard]] std::vector<trace_event> contents() const {
+    auto h = head.load(std::memory_order_acquire);
+    size_t first = h > mask ? h - mask - 1 : 0;
+    std::vector<trace_event> result;
+    result.reserve(h - first);
+    for (size_t i = first; i < h; i++) result.push_back(events[i & mask]);
+    return result;
+  }
+
+  [[nodiscard]] size_t num_dropped() const {
+    auto h = head.load(std::memory_order_acquire);
+    return h > mask ? h - mask - 1 : 0;
+  }
+
+ private:
+  std::unique_ptr<trace_event[]> events;
+  size_t mask;
+  std::atomic<size_t> head{0};
+};
+
+}  // namespace internal
+
+class scheduler_trace : private internal::trace_recorder {
+ public:
+  // Start recording the workers of the current scheduler, keeping the
+  // most recent events_per_worker events of each
+  explicit scheduler_trace(size_t events_per_worker = size_t{1} << 16)
+      : start_time(std::chrono::steady_clock::now()),
+        rings([events_per_worker](size_t) { return internal::trace_ring(events_per_worker); }) {
+#if defined(PARLAY_USING_PARLAY_SCHEDULER)
+    owner = &internal::get_current_scheduler();
+    owner->set_trace_recorder(this);
+#endif
+  }
+
+  scheduler_trace(const scheduler_trace&) = delete;
+  scheduler_trace& operator=(const scheduler_trace&) = delete;
+
+  ~scheduler_trace() { stop(); }
+
+  // Stop recording. Must be called from the thread that started the trace,
+  // or a worker of its scheduler.
+  void stop() {
+#if defined(PARLAY_USING_PARLAY_SCHEDULER)
+    if (owner != nullptr) {
+      owner->set_trace_recorder(nullptr);
+      owner = nullptr;
+    }
+#endif
+  }
+
+  // The number of events recorded and still held by the ring buffers
+  [[nodiscard]] size_t num_events() const {
+    size_t total = 0;
+    for (const auto& ring : rings) total += ring.contents().size();
+    return total;
+  }
+
+  // The number of events that were overwritten because a ring buffer was full
+  [[nodiscard]] size_t num_dropped_events() const {
+    size_t total = 0;
+    for (const auto& ring : rings) total += ring.num_dropped();
+    return total;
+  }
+
+  // Stop recording and write the trace in Chrome's JSON trace event format.
+  // Jobs whose beginning was overwritten are left out.
+  void write_chrome_trace(std::ostream& os) {
+    stop();
+    os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    bool first = true;
+    auto begin_event = [&]() -> std::ostream& {
+      if (!first) os << ",\n";
+      first = false;
+      return os;
+    };
+    auto timestamp = [](const internal::trace_event& e) {
+      // Chrome traces use microseconds
+      return std::to_string(e.time_ns / 1000) + "." + std::to_string(1000 + e.time_ns % 1000).substr(1);
+    };
+    size_t worker = 0;
+    for (const auto& ring : rings) {
+      begin_event() << R"({"name":"thread_name","ph":"M","pid":0,"tid":)" << worker
+                    << R"(,"args":{"name":"worker )" << worker << "\"}}";
+      size_t depth = 0;
+      for (const auto& e : ring.contents()) {
+        using type = internal::trace_event_type;
+        switch (e.type) {
+          case type::job_begin:
+            depth++;
+            begin_event() << R"({"name":"job","cat":"job","ph":"B","pid":0,"tid":)" << worker
+                          << ",\"ts\":" << timestamp(e) << R"(,"args":{"priority":)" << e.arg << "}}";
+            break;
+          case type::job_end:
+            if (depth == 0) break;
+            depth--;
+            begin_event() << R"({"ph":"E","pid":0,"tid":)" << worker << ",\"ts\":" << timestamp(e) << "}";
+            break;
+          case type::steal:
+            begin_event() << R"({"name":"steal","cat":"steal","ph":"i","s":"t","pid":0,"tid":)" << worker
+                          << ",\"ts\":" << timestamp(e) << R"(,"args":{"victim":)" << e.arg << "}}";
+            break;
+          case type::sleep_begin:
+            depth++;
+            begin_event() << R"({"name":"sleep","cat":"sleep","ph":"B","pid":0,"tid":)" << worker
+                          << ",\"ts\":" << timestamp(e) << "}";
+            break;
+          case type::sleep_end:
+            if (depth == 0) break;
+            depth--;
+            begin_event() << R"({"ph":"E","pid":0,"tid":)" << worker << ",\"ts\":" << timestamp(e) << "}";
+            break;
+        }
+      }
+      worker++;
+    }
+    os << "\n]}\n";
+  }
+
+  // Stop recording and write the trace to the given file
+  void write_chrome_trace(const std::string& filename) {
+    std::ofstream file(filename);
+    write_chrome_trace(file);
+  }
+
+ private:
+  std::chrono::steady_clock::time_point start_time;
+  WorkerSpecific<internal::trace_ring> rings;
+#if defined(PARLAY_USING_PARLAY_SCHEDULER)
+  internal::scheduler_type* owner{nullptr};
+#endif
+
+  void record(size_t worker, internal::trace_event_type type, size_t arg) noexcept override {
+    auto t = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time);
+    rings.begin()[worker].push({t.count(), arg, type});
+  }
+};
+
+}  // namespace parlay
+
+#endif  // PARLAY_TRACE_H_
@@ -1,11 +1,23 @@
 #include "gtest/gtest.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include <parlay/alloc.h>
+#include <parlay/parallel.h>
 #include <parlay/random.h>
 
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 
 TEST(TestAllocator, TestParlayAllocator) {
   std::vector<int, parlay::allocator<int>> a;
@@ -161,6 +173,283 @@ TEST(TestAllocator, TestTypeAllocatorLarge) {
   Xallocator::free(x);
 }
 
+// Repeatedly allocating and freeing the same large temporary should reuse
+// the cached block rather than going to the system each time
+TEST(TestAllocator, TestLargeAllocationCache) {
+  constexpr size_t n = size_t{1} << 20;
+  parlay::allocator<char> alloc;
+  alloc.deallocate(alloc.allocate(n), n);
+  auto before = parlay::large_allocation_stats();
+  for (int i = 0; i < 100; i++) {
+    char* p = alloc.allocate(n);
+    p[0] = p[n - 1] = 'a';
+    alloc.deallocate(p, n);
+  }
+  auto after = parlay::large_allocation_stats();
+  ASSERT_EQ(after.hits - before.hits, 100);
+  ASSERT_EQ(after.misses, before.misses);
+  ASSERT_GE(after.cached_bytes, n);
+  ASSERT_GT(after.hit_rate(), 0);
+}
+
+TEST(TestAllocator, TestLargeAllocationCacheLimit) {
+  constexpr size_t n = size_t{1} << 20;
+  constexpr size_t count = 20;
+  parlay::allocator<char> alloc;
+  parlay::internal::memory_clear();
+  parlay::set_large_allocation_cache_limit(4 * n);
+  auto before = parlay::large_allocation_stats();
+  std::vector<char*> blocks;
+  for (size_t i = 0; i < count; i++) blocks.push_back(alloc.allocate(n));
+  for (char* p : blocks) alloc.deallocate(p, n);
+  auto after = parlay::large_allocation_stats();
+  ASSERT_LE(after.cached_bytes, 4 * n);
+  ASSERT_EQ(after.evictions - before.evictions, count - 4);
+  parlay::set_large_allocation_cache_limit(PARLAY_LARGE_ALLOCATION_CACHE_LIMIT);
+  parlay::internal::memory_clear();
+  ASSERT_EQ(parlay::large_allocation_stats().cached_bytes, 0);
+}
+
+// Large blocks freed by one thread can be allocated by another
+TEST(TestAllocator, TestLargeAllocationCacheParallel) {
+  constexpr size_t n = size_t{1} << 19;
+  parlay::allocator<char> alloc;
+  std::vector<char*> blocks(64);
+  for (int round = 0; round < 10; round++) {
+    parlay::parallel_for(0, blocks.size(), [&](size_t i) {
+      blocks[i] = alloc.allocate(n);
+      std::fill(blocks[i], blocks[i] + n, static_cast<char>(i));
+    }, 1);
+    for (size_t i = 0; i < blocks.size(); i++) {
+      ASSERT_EQ(blocks[i][n / 2], static_cast<char>(i));
+    }
+    parlay::parallel_for(0, blocks.size(), [&](size_t i) {
+      alloc.deallocate(blocks[(i + round) % blocks.size()], n);
+    }, 1);
+  }
+}
+
+TEST(TestAllocator, TestBlockAllocatorTrim) {
+  constexpr size_t n = 100000;
+  parlay::internal::block_allocator a(64);
+  std::vector<void*> blocks(n);
+  for (size_t i = 0; i < n; i++) blocks[i] = a.alloc();
+  for (size_t i = 0; i < n; i++) a.free(blocks[i]);
+  size_t allocated = a.num_allocated_blocks();
+  size_t released = a.trim();
+  ASSERT_GT(released, 0);
+  ASSERT_EQ(a.num_allocated_blocks() * 64 + released, allocated * 64);
+  ASSERT_EQ(a.num_used_blocks(), 0);
+  for (size_t i = 0; i < n; i++) {
+    blocks[i] = a.alloc();
+    *static_cast<size_t*>(blocks[i]) = i;
+  }
+  for (size_t i = 0; i < n; i++) {
+    ASSERT_EQ(*static_cast<size_t*>(blocks[i]), i);
+    a.free(blocks[i]);
+  }
+  ASSERT_EQ(a.num_used_blocks(), 0);
+}
+
+TEST(TestAllocator, TestMemoryTrim) {
+  constexpr size_t n = size_t{1} << 20;
+  parlay::allocator<char> alloc;
+  alloc.deallocate(alloc.allocate(n), n);
+  auto before = parlay::memory_trim_stats();
+  size_t released = parlay::memory_trim();
+  auto after = parlay::memory_trim_stats();
+  ASSERT_GE(released, n);
+  ASSERT_EQ(after.trims - before.trims, 1);
+  ASSERT_EQ(after.released_bytes - before.released_bytes, released);
+  ASSERT_EQ(parlay::large_allocation_stats().cached_bytes, 0);
+}
+
+// Trimming while other threads allocate and free memory
+TEST(TestAllocator, TestMemoryTrimParallel) {
+  std::atomic<bool> done{false};
+  std::thread trimmer([&]() {
+    while (!done.load()) parlay::memory_trim();
+  });
+  for (int round = 0; round < 10; round++) {
+    parlay::parallel_for(0, 1000, [&](size_t i) {
+      size_t n = size_t{16} << (i % 16);
+      std::vector<size_t, parlay::allocator<size_t>> v(n, i);
+      ASSERT_EQ(v[n / 2], i);
+    }, 1);
+  }
+  done.store(true);
+  trimmer.join();
+}
+
+TEST(TestAllocator, TestMemoryTrimPolicy) {
+  using namespace std::chrono_literals;
+  constexpr size_t n = size_t{1} << 20;
+  parlay::allocator<char> alloc;
+  auto before = parlay::memory_trim_stats();
+  parlay::set_memory_trim_policy({10ms, 20ms, 0});
+  alloc.deallocate(alloc.allocate(n), n);
+  auto deadline = std::chrono::steady_clock::now() + 10s;
+  while (parlay::memory_trim_stats().trims == before.trims && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(10ms);
+  }
+  parlay::set_memory_trim_policy({});
+  ASSERT_GT(parlay::memory_trim_stats().trims, before.trims);
+}
+
+TEST(TestAllocator, TestHugePageAllocator) {
+  std::vector<int, parlay::huge_page_allocator<int>> small(100);
+  std::vector<int, parlay::huge_page_allocator<int>> large(size_t{1} << 22);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(large.data()) % parlay::internal::huge_page_size, 0);
+  for (size_t i = 0; i < small.size(); i++) small[i] = i;
+  for (size_t i = 0; i < large.size(); i++) large[i] = i;
+  for (size_t i = 0; i < large.size(); i++) {
+    ASSERT_EQ(large[i], i);
+  }
+  large.resize(size_t{1} << 23);
+  ASSERT_EQ(large[12345], 12345);
+}
+
+TEST(TestAllocator, TestHugePageSequence) {
+  size_t n = size_t{1} << 21;
+  parlay::sequence<size_t, parlay::huge_page_allocator<size_t>> s(n);
+  parlay::parallel_for(0, n, [&](size_t i) { s[i] = i; });
+  for (size_t i = 0; i < n; i++) {
+    ASSERT_EQ(s[i], i);
+  }
+}
+
+template<typename Alloc>
+void test_numa_allocator() {
+  size_t n = size_t{1} << 21;
+  auto s = parlay::sequence<size_t, Alloc>::uninitialized(n);
+  parlay::parallel_for(0, n, [&](size_t i) { s[i] = i; });
+  for (size_t i = 0; i < n; i++) {
+    ASSERT_EQ(s[i], i);
+  }
+  parlay::sequence<int, Alloc> t(n, 42);
+  for (size_t i = 0; i < n; i++) {
+    ASSERT_EQ(t[i], 42);
+  }
+  parlay::sequence<int, Alloc> small(10, 1);
+  ASSERT_EQ(small[9], 1);
+}
+
+TEST(TestAllocator, TestNumaAllocatorInterleave) {
+  test_numa_allocator<parlay::numa_allocator<size_t, parlay::numa_policy::interleave>>();
+}
+
+TEST(TestAllocator, TestNumaAllocatorFirstTouch) {
+  test_numa_allocator<parlay::numa_allocator<size_t, parlay::numa_policy::first_touch>>();
+}
+
+#if defined(__linux__) && defined(SYS_move_pages)
+
+// The NUMA node of each page of [p, p + n), or a negative error for pages
+// that are not resident. Returns an empty list if this can not be queried.
+std::vector<int> page_nodes(void* p, size_t n) {
+  size_t page_size = parlay::internal::os_page_size();
+  size_t num_pages = (n + page_size - 1) / page_size;
+  std::vector<void*> pages(num_pages);
+  for (size_t i = 0; i < num_pages; i++) pages[i] = static_cast<char*>(p) + i * page_size;
+  std::vector<int> status(num_pages);
+  if (syscall(SYS_move_pages, 0, num_pages, pages.data(), nullptr, status.data(), 0) != 0) return {};
+  return status;
+}
+
+TEST(TestAllocator, TestNumaAllocatorPlacement) {
+  const auto& node_ids = parlay::internal::get_numa_topology().node_ids;
+  size_t n = size_t{1} << 22;
+  size_t bytes = n * sizeof(size_t);
+
+  // First touch places every page when it is allocated
+  parlay::numa_allocator<size_t, parlay::numa_policy::first_touch> first_touch;
+  size_t* a = first_touch.allocate(n);
+  auto nodes = page_nodes(a, bytes);
+  if (nodes.empty()) {
+    first_touch.deallocate(a, n);
+    GTEST_SKIP() << "move_pages is not available to query the placement of pages";
+  }
+  for (int node : nodes) {
+    ASSERT_GE(node, 0);
+    ASSERT_NE(std::find(node_ids.begin(), node_ids.end(), static_cast<unsigned int>(node)), node_ids.end());
+  }
+  first_touch.deallocate(a, n);
+
+  // Interleaved pages are placed round-robin when they are touched, even
+  // by a single thread
+  parlay::numa_allocator<size_t, parlay::numa_policy::interleave> interleave;
+  size_t* b = interleave.allocate(n);
+  for (size_t i = 0; i < n; i++) b[i] = i;
+  nodes = page_nodes(b, bytes);
+  ASSERT_FALSE(nodes.empty());
+  std::vector<int> used;
+  for (int node : nodes) {
+    ASSERT_GE(node, 0);
+    if (std::find(used.begin(), used.end(), node) == used.end()) used.push_back(node);
+  }
+  ASSERT_EQ(used.size(), node_ids.size());
+  interleave.deallocate(b, n);
+}
+
+#endif  // defined(__linux__) && defined(SYS_move_pages)
+
+TEST(TestAllocator, TestMemoryAccounting) {
+  parlay::reset_memory_peaks();
+  size_t n = 1 << 22;
+  {
+    parlay::memory_scope scope("test");
+    std::vector<char, parlay::allocator<char>> v(n);
+    auto p = parlay::type_allocator<std::pair<long, long>>::create(1, 2);
+    parlay::type_allocator<std::pair<long, long>>::destroy(p);
+  }
+  auto report = parlay::memory_accounting_report();
+#if PARLAY_MEMORY_ACCOUNTING
+  ASSERT_GE(report.total.peak_bytes, n);
+  ASSERT_GE(report.total.allocations, 1);
+  auto size_class = std::find_if(report.size_classes.begin(), report.size_classes.end(),
+                                 [&](const auto& c) { return c.first == n; });
+  ASSERT_NE(size_class, report.size_classes.end());
+  ASSERT_GE(size_class->second.peak_bytes, n);
+  ASSERT_GE(size_class->second.allocations, 1);
+  ASSERT_EQ(size_class->second.allocations, size_class->second.deallocations);
+  auto type = std::find_if(report.types.begin(), report.types.end(),
+                           [](const auto& t) { return t.first.find("pair") != std::string::npos; });
+  ASSERT_NE(type, report.types.end());
+  ASSERT_EQ(type->second.allocations, 1);
+  ASSERT_EQ(type->second.current_bytes, 0);
+  ASSERT_EQ(report.scopes.size(), 1);
+  ASSERT_EQ(report.scopes[0].first, "test");
+  ASSERT_EQ(report.scopes[0].second.entries, 1);
+  ASSERT_GE(report.scopes[0].second.allocated_bytes, n);
+  ASSERT_GE(report.scopes[0].second.peak_bytes, n);
+  std::ostringstream ss;
+  ss << report;
+  ASSERT_NE(ss.str().find("test"), std::string::npos);
+  parlay::reset_memory_peaks();
+  ASSERT_TRUE(parlay::memory_accounting_report().scopes.empty());
+#else
+  ASSERT_TRUE(report.size_classes.empty());
+  ASSERT_TRUE(report.types.empty());
+  ASSERT_TRUE(report.scopes.empty());
+#endif
+}
+
+TEST(TestAllocator, TestMemoryAccountingParallel) {
+  size_t n = 1 << 20;
+  parlay::parallel_for(0, 1000, [&](size_t) {
+    std::vector<int, parlay::allocator<int>> v(n / 1000);
+  });
+  auto report = parlay::memory_accounting_report();
+#if PARLAY_MEMORY_ACCOUNTING
+  ASSERT_LE(report.total.current_bytes, report.total.peak_bytes);
+  for (const auto& [size, s] : report.size_classes) {
+    ASSERT_LE(s.deallocations, s.allocations);
+  }
+#else
+  ASSERT_EQ(report.total.allocations, 0);
+#endif
+}
+
 
 parlay::sequence<parlay::sequence<int>> a;
 
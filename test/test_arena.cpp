@@ -0,0 +1,125 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include <parlay/arena.h>
+#include <parlay/parallel.h>
+#include <parlay/primitives.h>
+#include <parlay/sequence.h>
+
+template<typename T>
+using arena_sequence = parlay::sequence<T, parlay::arena_allocator<T>>;
+
+TEST(TestArena, TestAllocatorWithoutArena) {
+  ASSERT_EQ(parlay::internal::current_arena(), nullptr);
+  arena_sequence<int> s(100000, 1);
+  s.push_back(2);
+  ASSERT_EQ(s.size(), 100001);
+  ASSERT_EQ(s[0], 1);
+  ASSERT_EQ(s[100000], 2);
+}
+
+TEST(TestArena, TestAllocateFromArena) {
+  parlay::arena a;
+  ASSERT_EQ(parlay::internal::current_arena(), &a);
+  ASSERT_EQ(a.bytes_reserved(), 0);
+  arena_sequence<int> s(1000, 1);
+  for (int i = 0; i < 1000; i++) s.push_back(i);
+  ASSERT_EQ(s.size(), 2000);
+  ASSERT_EQ(s[1999], 999);
+  ASSERT_GT(a.bytes_reserved(), 0);
+}
+
+TEST(TestArena, TestNestedArenas) {
+  parlay::arena outer;
+  {
+    parlay::arena inner;
+    ASSERT_EQ(parlay::internal::current_arena(), &inner);
+    arena_sequence<long> s(10, 1);
+    ASSERT_GT(inner.bytes_reserved(), 0);
+    ASSERT_EQ(outer.bytes_reserved(), 0);
+  }
+  ASSERT_EQ(parlay::internal::current_arena(), &outer);
+}
+
+// Without an arena, allocations are those of the default sequence allocator
+TEST(TestArena, TestNoHeaderWithoutArena) {
+  parlay::arena_allocator<int> alloc;
+  int* p = alloc.allocate(1000);
+  p[999] = 1;
+  parlay::internal::sequence_default_allocator<int>{}.deallocate(p, 1000);
+  p = parlay::internal::sequence_default_allocator<int>{}.allocate(1000);
+  p[999] = 2;
+  alloc.deallocate(p, 1000);
+}
+
+// Memory from outside an arena, or from an enclosing one, can be freed
+// inside it
+TEST(TestArena, TestFreeInsideArena) {
+  arena_sequence<int> s(1000, 1);
+  parlay::arena outer;
+  ASSERT_FALSE(outer.owns(s.data()));
+  arena_sequence<int> t(100, 2);
+  ASSERT_TRUE(outer.owns(t.data()));
+  {
+    parlay::arena inner;
+    s = arena_sequence<int>(10, 3);
+    t = arena_sequence<int>(10, 4);
+    ASSERT_TRUE(inner.owns(s.data()));
+    ASSERT_FALSE(outer.owns(s.data()));
+    ASSERT_EQ(s[9] + t[9], 7);
+    s.clear();
+    t.clear();
+  }
+}
+
+TEST(TestArena, TestOverAligned) {
+  struct alignas(64) X { char c; };
+  parlay::arena a;
+  arena_sequence<X> s(3);
+  arena_sequence<char> t(5);
+  arena_sequence<X> u(7);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(s.data()) % 64, 0);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(u.data()) % 64, 0);
+}
+
+// Jobs stolen by other workers allocate from the arena of the fork
+TEST(TestArena, TestArenaPassedToWorkers) {
+  constexpr size_t n = 10000;
+  parlay::arena a;
+  std::atomic<size_t> in_arena{0};
+  std::vector<size_t> sums(n);
+  parlay::parallel_for(0, n, [&](size_t i) {
+    if (parlay::internal::current_arena() == &a) in_arena++;
+    arena_sequence<size_t> tmp(i % 100 + 1, i);
+    sums[i] = parlay::reduce(tmp);
+  }, 1);
+  ASSERT_EQ(in_arena.load(), n);
+  for (size_t i = 0; i < n; i++) {
+    ASSERT_EQ(sums[i], (i % 100 + 1) * i);
+  }
+}
+
+// Results of primitives do not come from the arena, so they outlive it
+TEST(TestArena, TestPrimitivesInArena) {
+  constexpr long n = 1000000;
+  auto a = parlay::tabulate(n, [](long i) { return i; });
+  parlay::sequence<long> evens;
+  std::pair<parlay::sequence<long>, long> scanned;
+  for (int round = 0; round < 3; round++) {
+    parlay::arena phase;
+    evens = parlay::filter(a, [](long x) { return x % 2 == 0; });
+    scanned = parlay::scan(a);
+    ASSERT_EQ(parlay::reduce(a), n * (n - 1) / 2);
+    auto odds = parlay::pack(a, parlay::delayed_tabulate(n, [](long i) { return i % 2 == 1; }));
+    ASSERT_EQ(odds.size(), n / 2);
+  }
+  ASSERT_EQ(evens.size(), n / 2);
+  for (long i = 0; i < n / 2; i++) {
+    ASSERT_EQ(evens[i], 2 * i);
+  }
+  ASSERT_EQ(scanned.second, n * (n - 1) / 2);
+  ASSERT_EQ(scanned.first[n - 1], (n - 1) * (n - 2) / 2);
+}
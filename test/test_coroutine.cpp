@@ -0,0 +1,121 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+#include <parlay/coroutine.h>
+#include <parlay/parallel.h>
+#include <parlay/primitives.h>
+#include <parlay/sequence.h>
+
+#if defined(__cpp_impl_coroutine)
+
+parlay::task<int> return_value(int x) {
+  co_return x;
+}
+
+parlay::task<int> add_values(int x, int y) {
+  int a = co_await return_value(x);
+  int b = co_await return_value(y);
+  co_return a + b;
+}
+
+TEST(TestCoroutine, TestSyncWait) {
+  ASSERT_EQ(parlay::sync_wait(return_value(42)), 42);
+}
+
+TEST(TestCoroutine, TestAwaitTask) {
+  ASSERT_EQ(parlay::sync_wait(add_values(1, 2)), 3);
+}
+
+parlay::task<void> set_flag(std::atomic<bool>& flag) {
+  flag = true;
+  co_return;
+}
+
+TEST(TestCoroutine, TestVoidTask) {
+  std::atomic<bool> flag{false};
+  parlay::sync_wait(set_flag(flag));
+  ASSERT_TRUE(flag);
+}
+
+parlay::task<size_t> sum_after_blocking(size_t n) {
+  auto s = co_await parlay::blocking([n]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return parlay::iota(n);
+  });
+  co_return parlay::reduce(s);
+}
+
+TEST(TestCoroutine, TestBlocking) {
+  ASSERT_EQ(parlay::sync_wait(sum_after_blocking(1000)), 1000 * 999 / 2);
+}
+
+#if defined(PARLAY_EXCEPTIONS_ENABLED)
+parlay::task<int> throw_after_blocking() {
+  co_await parlay::blocking([]() { throw std::runtime_error("failed"); });
+  co_return 0;
+}
+
+TEST(TestCoroutine, TestBlockingException) {
+  ASSERT_THROW(parlay::sync_wait(throw_after_blocking()), std::runtime_error);
+}
+#endif
+
+parlay::task<int> sleep_then_return(int x) {
+  co_await parlay::sleep_for(std::chrono::milliseconds(5));
+  co_return x;
+}
+
+TEST(TestCoroutine, TestSleepFor) {
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_EQ(parlay::sync_wait(sleep_then_return(7)), 7);
+  ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(5));
+}
+
+parlay::task<size_t> schedule_then_compute(size_t i) {
+  co_await parlay::schedule();
+  co_return i * i;
+}
+
+TEST(TestCoroutine, TestSchedule) {
+  ASSERT_EQ(parlay::sync_wait(schedule_then_compute(5)), 25);
+}
+
+// Suspended coroutines must not occupy the workers, so that their sleeps
+// overlap: a parallel loop of tasks that each sleep should take far less
+// than the sum of their sleeps, even with a single worker
+TEST(TestCoroutine, TestManyTasksInParallel) {
+  size_t n = 200;
+  auto start = std::chrono::steady_clock::now();
+  auto results = parlay::tabulate(n, [](size_t i) {
+    return parlay::sync_wait(sleep_then_return(static_cast<int>(i)));
+  }, 1);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  for (size_t i = 0; i < n; i++) {
+    ASSERT_EQ(results[i], static_cast<int>(i));
+  }
+  ASSERT_LT(elapsed, n * std::chrono::milliseconds(5) / 2);
+}
+
+TEST(TestCoroutine, TestMixedWithParallelWork) {
+  size_t n = 100;
+  std::atomic<size_t> total{0};
+  parlay::par_do(
+    [&]() {
+      parlay::parallel_for(0, n, [&](size_t i) {
+        total += parlay::sync_wait(sum_after_blocking(i));
+      }, 1);
+    },
+    [&]() {
+      auto s = parlay::sort(parlay::tabulate(100000, [](size_t i) { return (i * 7919) % 100000; }));
+      ASSERT_TRUE(parlay::is_sorted(s));
+    });
+  size_t expected = 0;
+  for (size_t i = 0; i < n; i++) expected += i * (i - 1) / 2;
+  ASSERT_EQ(total, expected);
+}
+
+#endif  // defined(__cpp_impl_coroutine)
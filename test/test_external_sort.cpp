@@ -0,0 +1,107 @@
+#include "gtest/gtest.h"
+
+#include <cstdio>
+
+#include <fstream>
+#include <functional>
+#include <string>
+#include <utility>
+
+#include <parlay/external_sort.h>
+#include <parlay/primitives.h>
+#include <parlay/random.h>
+#include <parlay/sequence.h>
+
+template<typename T>
+void write_records(const std::string& filename, const parlay::sequence<T>& records) {
+  std::ofstream out(filename, std::ios::out | std::ios::binary);
+  out.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(T)));
+}
+
+template<typename T>
+parlay::sequence<T> read_records(const std::string& filename) {
+  auto chars = parlay::chars_from_file(filename);
+  auto records = parlay::sequence<T>::uninitialized(chars.size() / sizeof(T));
+  std::copy(chars.begin(), chars.end(), reinterpret_cast<char*>(records.data()));
+  return records;
+}
+
+TEST(TestExternalSort, TestFitsInMemory) {
+  parlay::random r(0);
+  auto s = parlay::tabulate(100000, [&](size_t i) -> long long { return r.ith_rand(i) % 1000000; });
+  write_records("external_in.bin", s);
+  auto stats = parlay::external_sort<long long>("external_in.bin", "external_out.bin");
+  ASSERT_EQ(stats.num_runs, 1);
+  ASSERT_EQ(stats.num_records, s.size());
+  ASSERT_EQ(stats.bytes_written, s.size() * sizeof(long long));
+  ASSERT_EQ(read_records<long long>("external_out.bin"), parlay::sort(s));
+}
+
+TEST(TestExternalSort, TestManyRuns) {
+  parlay::random r(1);
+  auto s = parlay::tabulate(200000, [&](size_t i) -> unsigned int { return r.ith_rand(i); });
+  write_records("external_in.bin", s);
+  parlay::external_sort_options options;
+  options.memory_budget = 8000 * sizeof(unsigned int);
+  auto stats = parlay::external_sort<unsigned int>("external_in.bin", "external_out.bin", std::less<>(), options);
+  ASSERT_EQ(stats.num_runs, 50);
+  ASSERT_EQ(stats.bytes_read, 2 * s.size() * sizeof(unsigned int));
+  ASSERT_EQ(stats.bytes_written, 2 * s.size() * sizeof(unsigned int));
+  ASSERT_EQ(read_records<unsigned int>("external_out.bin"), parlay::sort(s));
+  ASSERT_FALSE(std::ifstream("external_out.bin.runs").is_open());
+}
+
+TEST(TestExternalSort, TestManyDuplicates) {
+  auto s = parlay::tabulate(100000, [](size_t i) -> int { return static_cast<int>((i * 7919) % 5); });
+  write_records("external_in.bin", s);
+  parlay::external_sort_options options;
+  options.memory_budget = 3000 * sizeof(int);
+  options.temp_filename = "external_runs.bin";
+  auto stats = parlay::external_sort<int>("external_in.bin", "external_out.bin", std::less<>(), options);
+  ASSERT_GT(stats.num_runs, 1);
+  ASSERT_EQ(read_records<int>("external_out.bin"), parlay::sort(s));
+}
+
+TEST(TestExternalSort, TestRunsLargerThanWindows) {
+  // With more runs than records in the merge windows, each chunk takes a
+  // record or so from each run
+  parlay::random r(2);
+  auto s = parlay::tabulate(20000, [&](size_t i) -> unsigned long { return r.ith_rand(i) % 100; });
+  write_records("external_in.bin", s);
+  parlay::external_sort_options options;
+  options.memory_budget = 100 * sizeof(unsigned long);
+  auto stats = parlay::external_sort<unsigned long>("external_in.bin", "external_out.bin", std::less<>(), options);
+  ASSERT_EQ(stats.num_runs, 400);
+  ASSERT_EQ(read_records<unsigned long>("external_out.bin"), parlay::sort(s));
+}
+
+TEST(TestExternalSort, TestCustomCompare) {
+  parlay::random r(3);
+  auto s = parlay::tabulate(50000, [&](size_t i) {
+    return std::make_pair(static_cast<int>(r.ith_rand(i) % 100), static_cast<int>(i)); });
+  write_records("external_in.bin", s);
+  parlay::external_sort_options options;
+  options.memory_budget = 4000 * sizeof(std::pair<int, int>);
+  auto greater_first = [](const auto& a, const auto& b) { return a.first > b.first; };
+  parlay::external_sort<std::pair<int, int>>("external_in.bin", "external_out.bin", greater_first, options);
+  auto sorted = read_records<std::pair<int, int>>("external_out.bin");
+  ASSERT_EQ(sorted.size(), s.size());
+  ASSERT_TRUE(std::is_sorted(sorted.begin(), sorted.end(), greater_first));
+  ASSERT_EQ(parlay::sort(sorted), parlay::sort(s));
+}
+
+TEST(TestExternalSort, TestEmpty) {
+  write_records("external_in.bin", parlay::sequence<int>());
+  auto stats = parlay::external_sort<int>("external_in.bin", "external_out.bin");
+  ASSERT_EQ(stats.num_records, 0);
+  ASSERT_TRUE(read_records<int>("external_out.bin").empty());
+}
+
+#if defined(PARLAY_EXCEPTIONS_ENABLED)
+TEST(TestExternalSort, TestBadInput) {
+  write_records("external_in.bin", parlay::sequence<char>(10, 'a'));
+  EXPECT_THROW({ parlay::external_sort<int>("external_in.bin", "external_out.bin"); }, std::invalid_argument);
+  std::remove("external_missing.bin");
+  EXPECT_THROW({ parlay::external_sort<int>("external_missing.bin", "external_out.bin"); }, std::runtime_error);
+}
+#endif
@@ -0,0 +1,123 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <parlay/future.h>
+#include <parlay/parallel.h>
+#include <parlay/primitives.h>
+#include <parlay/sequence.h>
+
+TEST(TestFuture, TestSpawnGet) {
+  auto f = parlay::spawn([]() { return 42; });
+  ASSERT_TRUE(f.valid());
+  ASSERT_EQ(f.get(), 42);
+  ASSERT_FALSE(f.valid());
+}
+
+TEST(TestFuture, TestSpawnVoid) {
+  std::atomic<int> x{0};
+  auto f = parlay::spawn([&]() { x = 1; });
+  f.wait();
+  ASSERT_TRUE(f.ready());
+  f.get();
+  ASSERT_EQ(x, 1);
+}
+
+TEST(TestFuture, TestMoveOnlyResult) {
+  auto f = parlay::spawn([]() { return std::make_unique<std::string>("hello"); });
+  auto p = f.get();
+  ASSERT_EQ(*p, "hello");
+}
+
+TEST(TestFuture, TestDestroyWithoutGet) {
+  std::atomic<int> x{0};
+  {
+    auto f = parlay::spawn([&]() { x = 1; });
+  }
+  ASSERT_EQ(x, 1);
+}
+
+TEST(TestFuture, TestMoveAssign) {
+  std::atomic<int> x{0};
+  auto f = parlay::spawn([&]() { x++; return 1; });
+  f = parlay::spawn([&]() { x++; return 2; });
+  ASSERT_GE(x.load(), 1);
+  ASSERT_EQ(f.get(), 2);
+  ASSERT_EQ(x, 2);
+}
+
+TEST(TestFuture, TestDag) {
+  size_t n = 100000;
+  auto input = parlay::spawn([&]() { return parlay::tabulate(n, [&](size_t i) { return (i * 7919) % n; }); });
+  auto sorted = parlay::spawn([&]() { return parlay::sort(input.get()); });
+  auto sum = parlay::spawn([&]() { return parlay::reduce(sorted.get()); });
+  auto count = parlay::spawn([&]() { return parlay::count_if(parlay::iota(n), [](size_t i) { return i % 2 == 0; }); });
+  ASSERT_EQ(sum.get(), n * (n - 1) / 2);
+  ASSERT_EQ(count.get(), n / 2);
+}
+
+TEST(TestFuture, TestManyFutures) {
+  size_t n = 10000;
+  std::vector<parlay::future<size_t>> futures;
+  for (size_t i = 0; i < n; i++) {
+    futures.push_back(parlay::spawn([i]() { return i * i; }));
+  }
+  for (size_t i = n; i > 0; i--) {
+    ASSERT_EQ(futures[i - 1].get(), (i - 1) * (i - 1));
+  }
+}
+
+TEST(TestFuture, TestFuturesInsideParallelFor) {
+  size_t n = 1000;
+  std::vector<size_t> result(n);
+  parlay::parallel_for(0, n, [&](size_t i) {
+    auto a = parlay::spawn([i]() { return i; });
+    auto b = parlay::spawn([i]() { return 2 * i; });
+    result[i] = a.get() + b.get();
+  });
+  for (size_t i = 0; i < n; i++) {
+    ASSERT_EQ(result[i], 3 * i);
+  }
+}
+
+TEST(TestFuture, TestUnjoinedFutureInsideParDo) {
+  size_t n = 1000;
+  std::vector<parlay::future<size_t>> futures(n);
+  std::vector<size_t> other(n);
+  parlay::parallel_for(0, n, [&](size_t i) {
+    parlay::par_do(
+      [&]() { futures[i] = parlay::spawn([i]() { return i + 1; }); },
+      [&]() { other[i] = i; }
+    );
+  });
+  for (size_t i = 0; i < n; i++) {
+    ASSERT_EQ(futures[i].get(), i + 1);
+    ASSERT_EQ(other[i], i);
+  }
+}
+
+TEST(TestFuture, TestWaitOutsidePriorityScope) {
+  // The job is pushed onto the deque of the high priority level, which
+  // must still be run once no high priority work is active
+  for (size_t i = 0; i < 100; i++) {
+    parlay::future<size_t> f;
+    parlay::execute_with_priority(parlay::priority::high, [&]() {
+      f = parlay::spawn([i]() { return i; });
+    });
+    ASSERT_EQ(f.get(), i);
+  }
+  std::atomic<size_t> x{0};
+  {
+    parlay::future<void> g;
+    parlay::execute_with_priority(parlay::priority::high, [&]() { g = parlay::spawn([&]() { x = 1; }); });
+  }
+  ASSERT_EQ(x, 1);
+  std::vector<parlay::future<size_t>> futures;
+  parlay::execute_with_priority(parlay::priority::background, [&]() {
+    for (size_t i = 0; i < 100; i++) futures.push_back(parlay::spawn([i]() { return i; }));
+  });
+  for (size_t i = 0; i < 100; i++) ASSERT_EQ(futures[i].get(), i);
+}
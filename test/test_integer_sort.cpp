@@ -93,3 +93,50 @@ TEST(TestIntegerSort, TestIntegerSortCopyAndDestructiveMove) {
     ASSERT_EQ(real_sorted[i].value(), sorted[i].value());
   }
 }
+
+TEST(TestIntegerSort, TestRadixSortInplace) {
+  for (size_t n : {0, 1, 1000, 131072, 1000003}) {
+    auto s = parlay::tabulate(n, [](size_t i) -> unsigned long long {
+      return parlay::hash64(i);
+    });
+    auto sorted = s;
+    std::sort(std::begin(sorted), std::end(sorted));
+    parlay::internal::radix_sort_inplace(make_slice(s), [](auto x) { return x; });
+    ASSERT_EQ(s, sorted);
+  }
+}
+
+TEST(TestIntegerSort, TestRadixSortInplaceSkewed) {
+  size_t n = 1000000;
+  // Few distinct keys, and many keys in one bucket, make blocks and buckets straddle each other
+  auto s = parlay::tabulate(n, [](size_t i) -> unsigned int {
+    return (i % 3 == 0) ? 5 : static_cast<unsigned int>(parlay::hash64(i) % 7) << 20;
+  });
+  auto sorted = s;
+  std::sort(std::begin(sorted), std::end(sorted));
+  parlay::internal::radix_sort_inplace(make_slice(s), [](auto x) { return x; });
+  ASSERT_EQ(s, sorted);
+}
+
+TEST(TestIntegerSort, TestRadixSortInplacePairs) {
+  size_t n = 500000;
+  auto s = parlay::tabulate(n, [](size_t i) {
+    return std::make_pair(static_cast<unsigned int>(parlay::hash64(i) % 3000), i);
+  });
+  parlay::integer_sort_inplace(s, [](const auto& p) { return p.first; });
+  for (size_t i = 1; i < n; i++) {
+    ASSERT_LE(s[i-1].first, s[i].first);
+  }
+  auto ids = parlay::integer_sort(parlay::map(s, [](const auto& p) { return p.second; }));
+  ASSERT_EQ(ids, parlay::tabulate(n, [](size_t i) { return i; }));
+}
+
+TEST(TestIntegerSort, TestRadixSortInplaceHeapInt) {
+  auto s = parlay::tabulate(300000, [](int i) {
+    return HeapInt((51 * i + 61) % (1 << 20));
+  });
+  parlay::integer_sort_inplace(s, [](const auto& p) { return static_cast<unsigned int>(p.value()); });
+  for (size_t i = 1; i < s.size(); i++) {
+    ASSERT_LE(s[i-1].value(), s[i].value());
+  }
+}
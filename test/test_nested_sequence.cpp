@@ -0,0 +1,156 @@
+#include "gtest/gtest.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <parlay/nested_sequence.h>
+#include <parlay/primitives.h>
+#include <parlay/sequence.h>
+
+static_assert(parlay::is_random_access_range_v<parlay::nested_sequence<int>>);
+static_assert(parlay::is_random_access_range_v<const parlay::nested_sequence<int>>);
+
+TEST(TestNestedSequence, TestDefaultConstruct) {
+  auto s = parlay::nested_sequence<int>();
+  ASSERT_TRUE(s.empty());
+  ASSERT_EQ(s.size(), 0);
+  ASSERT_EQ(s.flat_size(), 0);
+  ASSERT_EQ(s.begin(), s.end());
+}
+
+TEST(TestNestedSequence, TestFromOffsetsAndValues) {
+  auto offsets = parlay::sequence<size_t>{0, 2, 2, 5};
+  auto values = parlay::sequence<int>{1, 2, 3, 4, 5};
+  auto values_data = values.data();
+  auto s = parlay::nested_sequence<int>(std::move(offsets), std::move(values));
+  ASSERT_EQ(s.size(), 3);
+  ASSERT_EQ(s.flat_size(), 5);
+  ASSERT_EQ(s.values().begin(), values_data);
+  ASSERT_EQ(s.inner_size(0), 2);
+  ASSERT_EQ(s.inner_size(1), 0);
+  ASSERT_EQ(s.inner_size(2), 3);
+  ASSERT_EQ(s[1].size(), 0);
+  ASSERT_EQ(s[2][0], 3);
+  ASSERT_EQ(s.back()[2], 5);
+  s[0][1] = 10;
+  ASSERT_EQ(s.values()[1], 10);
+  ASSERT_EQ(s.at(2).size(), 3);
+#if defined(PARLAY_EXCEPTIONS_ENABLED)
+  EXPECT_THROW({ s.at(3); }, std::out_of_range);
+#endif
+}
+
+TEST(TestNestedSequence, TestFromSizes) {
+  auto s = parlay::nested_sequence<int>::from_sizes(parlay::sequence<size_t>{1, 0, 3}, parlay::sequence<int>{1, 2, 3, 4});
+  ASSERT_EQ(s.offsets(), (parlay::sequence<size_t>{0, 1, 1, 4}));
+  ASSERT_EQ(s[2][2], 4);
+}
+
+TEST(TestNestedSequence, TestCopyFromRange) {
+  std::vector<std::vector<int>> v = {{1, 2, 3}, {}, {4}, {5, 6}};
+  auto s = parlay::to_nested_sequence(v);
+  ASSERT_EQ(s.size(), v.size());
+  for (size_t i = 0; i < v.size(); i++) {
+    ASSERT_EQ(s[i].size(), v[i].size());
+    ASSERT_TRUE(std::equal(s[i].begin(), s[i].end(), v[i].begin()));
+  }
+  auto s2 = s;
+  ASSERT_EQ(s, s2);
+  s2[3][1] = 7;
+  ASSERT_NE(s, s2);
+}
+
+TEST(TestNestedSequence, TestRelocateFromSequenceOfSequences) {
+  size_t n = 10000;
+  auto nested = parlay::tabulate(n, [](size_t i) {
+    return parlay::tabulate(i % 7, [i](size_t j) { return parlay::sequence<int>(j, static_cast<int>(i)); });
+  });
+  auto s = parlay::to_nested_sequence(parlay::map(nested, [](auto& x) { return x; }));
+  auto r = parlay::nested_sequence<parlay::sequence<int>>(std::move(nested));
+  ASSERT_TRUE(nested.empty());
+  ASSERT_EQ(r, s);
+  ASSERT_EQ(r.size(), n);
+  for (size_t i = 0; i < n; i++) {
+    ASSERT_EQ(r[i].size(), i % 7);
+    for (size_t j = 0; j < r[i].size(); j++) {
+      ASSERT_EQ(r[i][j], parlay::sequence<int>(j, static_cast<int>(i)));
+    }
+  }
+}
+
+TEST(TestNestedSequence, TestIterators) {
+  auto s = parlay::to_nested_sequence(parlay::tabulate(1000, [](size_t i) {
+    return parlay::sequence<size_t>(i % 5, i); }));
+  auto sizes = parlay::map(s, [](auto&& inner) { return inner.size(); });
+  ASSERT_EQ(sizes, parlay::tabulate(1000, [](size_t i) { return i % 5; }));
+  const auto& cs = s;
+  size_t i = 0;
+  for (auto inner : cs) {
+    for (auto x : inner) ASSERT_EQ(x, i);
+    i++;
+  }
+  ASSERT_EQ(i, 1000);
+  ASSERT_EQ(cs.end() - cs.begin(), 1000);
+  ASSERT_EQ((*(s.rbegin()))[0], 999);
+  parlay::nested_sequence<size_t>::const_iterator it = s.begin();
+  ASSERT_EQ(it, cs.begin());
+}
+
+TEST(TestNestedSequence, TestFlatten) {
+  auto s = parlay::to_nested_sequence(parlay::tabulate(1000, [](size_t i) {
+    return parlay::sequence<size_t>(i % 5, i); }));
+  auto expected = parlay::flatten(parlay::tabulate(1000, [](size_t i) {
+    return parlay::sequence<size_t>(i % 5, i); }));
+  ASSERT_EQ(parlay::flatten(s), expected);
+  auto values_data = s.values().begin();
+  auto flat = parlay::flatten(std::move(s));
+  ASSERT_EQ(flat, expected);
+  ASSERT_EQ(flat.data(), values_data);
+  ASSERT_TRUE(s.empty());
+}
+
+TEST(TestNestedSequence, TestNestedGroupByIndex) {
+  for (size_t num_buckets : {size_t{3}, size_t{1000}}) {
+    size_t n = 100000;
+    auto pairs = parlay::tabulate(n, [&](size_t i) {
+      return std::make_pair(static_cast<unsigned int>((i * 7919) % num_buckets), static_cast<int>(i)); });
+    auto expected = parlay::group_by_index(pairs, static_cast<unsigned int>(num_buckets));
+    auto result = parlay::nested_group_by_index(pairs, static_cast<unsigned int>(num_buckets));
+    ASSERT_EQ(result.size(), num_buckets);
+    ASSERT_EQ(result.flat_size(), n);
+    for (size_t i = 0; i < num_buckets; i++) {
+      ASSERT_EQ(parlay::to_sequence(result[i]), expected[i]);
+    }
+  }
+}
+
+TEST(TestNestedSequence, TestNestedGroupByIndexEmpty) {
+  auto pairs = parlay::sequence<std::pair<int, int>>();
+  auto result = parlay::nested_group_by_index(pairs, 5);
+  ASSERT_EQ(result.size(), 5);
+  for (auto inner : result) ASSERT_EQ(inner.size(), 0);
+}
+
+TEST(TestNestedSequence, TestNestedTokens) {
+  std::string text = "  the quick\tbrown  fox\njumps over the lazy dog ";
+  auto expected = parlay::tokens(text);
+  auto result = parlay::nested_tokens(text);
+  ASSERT_EQ(result.size(), expected.size());
+  for (size_t i = 0; i < result.size(); i++) {
+    ASSERT_EQ(parlay::to_sequence(result[i]), parlay::to_sequence(expected[i]));
+  }
+  ASSERT_EQ(result.flat_size(), 35);
+  ASSERT_TRUE(parlay::nested_tokens(std::string("   ")).empty());
+  ASSERT_TRUE(parlay::nested_tokens(std::string()).empty());
+}
+
+TEST(TestNestedSequence, TestNestedTokensLarge) {
+  auto text = parlay::tabulate(1000000, [](size_t i) -> char { return (i % 13 == 0 || i % 17 == 0) ? ' ' : 'a' + i % 26; });
+  auto expected = parlay::tokens(text);
+  auto result = parlay::nested_tokens(text);
+  ASSERT_EQ(result.size(), expected.size());
+  for (size_t i = 0; i < result.size(); i++) {
+    ASSERT_TRUE(std::equal(result[i].begin(), result[i].end(), expected[i].begin(), expected[i].end()));
+  }
+}
@@ -1,13 +1,20 @@
 #include "gtest/gtest.h"
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <string>
 #include <thread>
 #include <vector>
 
 #include <parlay/alloc.h>
+#include <parlay/future.h>
 #include <parlay/parallel.h>
 
+#include <parlay/internal/growable_deque.h>
+
 
 TEST(TestParallel, TestParDo) {
   int x = 0, y = 0;
@@ -237,8 +244,223 @@ TEST(TestParallel, TestNestedAlloc) {
   });
 }
 
+TEST(TestParallel, TestGrowableDeque) {
+  constexpr int n = 100000;
+  std::vector<int> values(n);
+  std::vector<std::atomic<int>> taken(n);
+  parlay::internal::growable_deque<int> q;
+  std::atomic<bool> done{false};
+  std::atomic<int> num_taken{0};
+  auto take = [&](int* x) {
+    taken[x - values.data()]++;
+    num_taken++;
+  };
+  std::vector<std::thread> thieves;
+  for (int t = 0; t < 3; t++) {
+    thieves.emplace_back([&]() {
+      int* batch[decltype(q)::max_steal];
+      while (!done.load()) {
+        auto [count, empty] = q.pop_top_batch(batch, decltype(q)::max_steal);
+        for (size_t i = 0; i < count; i++) take(batch[i]);
+      }
+    });
+  }
+  // Push in bursts that force the buffer to grow, and pop some back
+  for (int i = 0; i < n; i++) {
+    q.push_bottom(&values[i]);
+    if (i % 3 == 0) {
+      if (int* x = q.pop_bottom()) take(x);
+    }
+  }
+  while (int* x = q.pop_bottom()) take(x);
+  while (num_taken.load() < n) std::this_thread::yield();
+  done = true;
+  for (auto& thief : thieves) thief.join();
+  for (int i = 0; i < n; i++) {
+    ASSERT_EQ(taken[i], 1);
+  }
+  ASSERT_EQ(q.size(), 0);
+}
+
+TEST(TestParallel, TestExecuteWithPriority) {
+  size_t n = 100000;
+  std::vector<int> v(n);
+  parlay::execute_with_priority(parlay::priority::high, [&]() {
+    parlay::parallel_for(0, n, [&](size_t i) { v[i] = i; });
+  });
+  for (size_t i = 0; i < n; i++) {
+    ASSERT_EQ(v[i], i);
+  }
+}
+
+#if defined(PARLAY_USING_PARLAY_SCHEDULER) && defined(PARLAY_EXCEPTIONS_ENABLED)
+TEST(TestParallel, TestPriorityRestoredOnException) {
+  auto& scheduler = parlay::internal::get_current_scheduler();
+  EXPECT_THROW({
+    parlay::execute_with_priority(parlay::priority::high, []() { throw std::runtime_error("error"); });
+  }, std::runtime_error);
+  ASSERT_EQ(scheduler.priority_level(), scheduler.normal_priority);
+  std::atomic<size_t> count{0};
+  parlay::parallel_for(0, 100000, [&](size_t) { count++; });
+  ASSERT_EQ(count.load(), 100000);
+}
+#endif
+
+TEST(TestParallel, TestMixedPriorities) {
+  size_t n = 200000;
+  std::vector<std::atomic<int>> background(n), high(n);
+  parlay::par_do(
+    [&]() {
+      parlay::execute_with_priority(parlay::priority::background, [&]() {
+        parlay::parallel_for(0, n, [&](size_t i) { background[i]++; }, 1);
+      });
+    },
+    [&]() {
+      for (size_t r = 0; r < 10; r++) {
+        parlay::execute_with_priority(parlay::priority::high, [&]() {
+          parlay::parallel_for(r * n / 10, (r + 1) * n / 10, [&](size_t i) {
+            parlay::par_do([&]() { high[i]++; }, [&]() { high[i]++; });
+          });
+        });
+      }
+    }
+  );
+  for (size_t i = 0; i < n; i++) {
+    ASSERT_EQ(background[i], 1);
+    ASSERT_EQ(high[i], 2);
+  }
+}
+
+#if PARLAY_SCHEDULER_STATS && PARLAY_ELASTIC_PARALLELISM
+
+// A job left on the deque of a priority level that no root is running can
+// not be stolen, so it must not keep the idle workers from sleeping
+TEST(TestParallel, TestIdleWithInactivePriorityJob) {
+  parlay::execute_with_scheduler(4, [&]() {
+    parlay::future<int> f;
+    parlay::execute_with_priority(parlay::priority::high, [&]() { f = parlay::spawn([]() { return 1; }); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    parlay::reset_scheduler_stats();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    auto sleeps = parlay::scheduler_stats().total().sleeps;
+    ASSERT_EQ(f.get(), 1);
+    ASSERT_LE(sleeps, parlay::num_workers());
+  });
+}
+
+#endif
+
+TEST(TestParallel, TestParForWithController) {
+  parlay::granularity_controller controller;
+  for (size_t n : {0, 1, 10, 1000, 100000, 10, 100000}) {
+    std::vector<std::atomic<int>> counts(n);
+    parlay::parallel_for(0, n, [&](size_t i) { counts[i]++; }, controller);
+    for (size_t i = 0; i < n; i++) {
+      ASSERT_EQ(counts[i], 1);
+    }
+  }
+}
+
+TEST(TestParallel, TestNestedParForWithController) {
+  static parlay::granularity_controller outer, inner;
+  std::vector<std::atomic<int>> counts(1000);
+  parlay::parallel_for(0, 100, [&](size_t i) {
+    parlay::parallel_for(0, 10, [&](size_t j) { counts[10 * i + j]++; }, inner);
+  }, outer);
+  for (size_t i = 0; i < 1000; i++) {
+    ASSERT_EQ(counts[i], 1);
+  }
+}
+
+TEST(TestParallel, TestGranularityController) {
+  parlay::granularity_controller controller;
+  ASSERT_FALSE(controller.calibrated());
+  controller.record(1000, 2 * PARLAY_ADAPTIVE_GRANULARITY_TARGET_NS);
+  ASSERT_TRUE(controller.calibrated());
+  ASSERT_EQ(controller.granularity(), 500);
+  // A single slower sample only moves the estimate part of the way
+  controller.record(1000, 100 * PARLAY_ADAPTIVE_GRANULARITY_TARGET_NS);
+  ASSERT_LT(controller.granularity(), 500);
+  ASSERT_GT(controller.granularity(), 10);
+  controller.reset();
+  ASSERT_FALSE(controller.calibrated());
+}
+
+TEST(TestParallel, TestNumaWorkerCounts) {
+  size_t num_nodes = parlay::num_numa_nodes();
+  ASSERT_GE(num_nodes, 1);
+  size_t total = 0;
+  for (size_t node = 0; node < num_nodes; node++) {
+    total += parlay::num_workers_on_node(node);
+  }
+  ASSERT_EQ(total, parlay::num_workers());
+  ASSERT_EQ(parlay::num_workers_on_node(num_nodes), 0);
+  parlay::parallel_for(0, 100000, [&](size_t) {
+    ASSERT_LT(parlay::numa_node_id(), num_nodes);
+  });
+}
+
 #if defined(PARLAY_USING_PARLAY_SCHEDULER)
 
+TEST(TestParallel, TestSchedulerStats) {
+  size_t n = 100000;
+  parlay::reset_scheduler_stats();
+  parlay::parallel_for(0, n, [](size_t) { }, 1);
+  auto stats = parlay::scheduler_stats();
+#if PARLAY_SCHEDULER_STATS
+  ASSERT_EQ(stats.workers.size(), parlay::num_workers());
+  auto total = stats.total();
+  // Every fork spawns a job that is either popped by its owner or stolen
+  ASSERT_GE(total.jobs_executed, n - 1);
+  ASSERT_GE(total.jobs_executed, total.steals);
+  ASSERT_GE(total.deque_high_water, 1);
+  ASSERT_GE(stats.job_imbalance(), 1.0);
+  std::ostringstream ss;
+  ss << stats;
+  ASSERT_NE(ss.str().find("total"), std::string::npos);
+  parlay::reset_scheduler_stats();
+  ASSERT_EQ(parlay::scheduler_stats().total().steals, 0);
+#else
+  ASSERT_TRUE(stats.workers.empty());
+#endif
+}
+
+TEST(TestParallel, TestParseCpuList) {
+  using list = std::vector<unsigned int>;
+  ASSERT_EQ(parlay::internal::parse_cpu_list("0-3,8,10-11\n"), (list{0, 1, 2, 3, 8, 10, 11}));
+  ASSERT_EQ(parlay::internal::parse_cpu_list("5"), (list{5}));
+  ASSERT_EQ(parlay::internal::parse_cpu_list(""), (list{}));
+}
+
+TEST(TestParallel, TestNumaTopology) {
+  const auto& topology = parlay::internal::get_numa_topology();
+  ASSERT_GE(topology.num_nodes(), 1);
+  ASSERT_EQ(topology.node_ids.size(), topology.num_nodes());
+  for (const auto& cpus : topology.node_cpus) {
+    ASSERT_FALSE(cpus.empty());
+  }
+}
+
+// On a machine with two nodes, thieves only prefer victims on their own
+// node if the workers are bound to their nodes, so the default policy,
+// which does not bind them, steals from all workers alike
+TEST(TestParallel, TestNumaStealingNeedsBinding) {
+  using scheduler = parlay::internal::scheduler_type;
+  parlay::internal::numa_topology topology;
+  topology.node_cpus = {{0, 1, 2, 3}, {4, 5, 6, 7}};
+  topology.node_ids = {0, 1};
+  auto none = scheduler::place_workers(8, parlay::affinity_policy::none(), topology);
+  ASSERT_FALSE(none.numa_stealing);
+  for (const auto& cpus : none.worker_cpus) {
+    ASSERT_TRUE(cpus.empty());
+  }
+  for (const auto& policy : {parlay::affinity_policy::nodes(), parlay::affinity_policy::compact(),
+                             parlay::affinity_policy::scatter(), parlay::affinity_policy::explicit_cpus({0, 4})}) {
+    auto placement = scheduler::place_workers(8, policy, topology);
+    ASSERT_EQ(placement.numa_stealing, bool(PARLAY_NUMA_AWARE));
+  }
+}
+
 TEST(TestParallel, TestMultipleSchedulers) {
 
   auto* current_scheduler = std::addressof(parlay::internal::get_current_scheduler());
@@ -250,4 +472,111 @@ TEST(TestParallel, TestMultipleSchedulers) {
 
 }
 
+TEST(TestParallel, TestAffinityPolicyFromString) {
+  using kind = parlay::affinity_policy::kind;
+  ASSERT_EQ(parlay::affinity_policy::from_string("compact").policy, kind::compact);
+  ASSERT_EQ(parlay::affinity_policy::from_string("scatter").policy, kind::scatter);
+  ASSERT_EQ(parlay::affinity_policy::from_string("none").policy, kind::none);
+  ASSERT_EQ(parlay::affinity_policy::from_string("nodes").policy, kind::nodes);
+  auto list = parlay::affinity_policy::from_string("0-2,5");
+  ASSERT_EQ(list.policy, kind::explicit_cpus);
+  ASSERT_EQ(list.cpus, (std::vector<unsigned int>{0, 1, 2, 5}));
+  ASSERT_EQ(parlay::affinity_policy::from_string("3\n").cpus, (std::vector<unsigned int>{3}));
+#if defined(PARLAY_EXCEPTIONS_ENABLED)
+  for (std::string bad : {"", "Compact", "scater", "0-", "3-1", "0,,2", "0-2,x"}) {
+    EXPECT_THROW({ parlay::affinity_policy::from_string(bad); }, std::invalid_argument) << bad;
+  }
+#endif
+}
+
+#if defined(PARLAY_EXCEPTIONS_ENABLED)
+TEST(TestParallel, TestInvalidExplicitAffinity) {
+  auto* current_scheduler = std::addressof(parlay::internal::get_current_scheduler());
+  EXPECT_THROW({
+    parlay::execute_with_scheduler(2, parlay::affinity_policy::explicit_cpus({}), []() {});
+  }, std::invalid_argument);
+#if defined(__linux__)
+  EXPECT_THROW({
+    parlay::execute_with_scheduler(2, parlay::affinity_policy::explicit_cpus({CPU_SETSIZE + 1}), []() {});
+  }, std::invalid_argument);
+#endif
+  ASSERT_EQ(std::addressof(parlay::internal::get_current_scheduler()), current_scheduler);
+  std::atomic<size_t> count{0};
+  parlay::parallel_for(0, 100000, [&](size_t) { count++; });
+  ASSERT_EQ(count.load(), 100000);
+}
+#endif
+
+#if PARLAY_GROWABLE_DEQUE
+
+// Nesting forks more deeply than a fixed-size deque could hold
+TEST(TestParallel, TestDeepNesting) {
+  constexpr size_t depth = 10000;
+  std::atomic<size_t> count{0};
+  auto nest = [&](auto& self, size_t d) -> void {
+    if (d == 0) return;
+    parlay::par_do([&]() { self(self, d - 1); }, [&]() { count++; });
+  };
+  nest(nest, depth);
+  ASSERT_EQ(count.load(), depth);
+}
+
+#endif  // PARLAY_GROWABLE_DEQUE
+
+#if defined(__linux__)
+
+TEST(TestParallel, TestExplicitAffinity) {
+  auto allowed = parlay::internal::allowed_cpus();
+  ASSERT_FALSE(allowed.empty());
+  std::vector<unsigned int> cpus(allowed.begin(), allowed.begin() + std::min<size_t>(2, allowed.size()));
+  auto before = parlay::internal::current_thread_cpus();
+
+  parlay::execute_with_scheduler(4, parlay::affinity_policy::explicit_cpus(cpus), [&]() {
+    std::vector<std::atomic<bool>> checked(parlay::num_workers());
+    parlay::parallel_for(0, 100000, [&](size_t) {
+      size_t id = parlay::worker_id();
+      if (!checked[id].exchange(true)) {
+        auto mine = parlay::internal::current_thread_cpus();
+        ASSERT_EQ(mine.size(), 1);
+        ASSERT_EQ(mine[0], cpus[id % cpus.size()]);
+      }
+    });
+  });
+
+  ASSERT_EQ(parlay::internal::current_thread_cpus(), before);
+}
+
+// Without a pinning policy, workers keep the affinity of the process, even
+// on machines with several NUMA nodes
+TEST(TestParallel, TestNoAffinityDoesNotBind) {
+  auto before = parlay::internal::current_thread_cpus();
+  parlay::execute_with_scheduler(4, parlay::affinity_policy::none(), [&]() {
+    std::vector<std::atomic<bool>> checked(parlay::num_workers());
+    parlay::parallel_for(0, 100000, [&](size_t) {
+      size_t id = parlay::worker_id();
+      if (!checked[id].exchange(true)) {
+        ASSERT_EQ(parlay::internal::current_thread_cpus(), before);
+      }
+    });
+  });
+}
+
+TEST(TestParallel, TestNodesAffinity) {
+  const auto& topology = parlay::internal::get_numa_topology();
+  auto before = parlay::internal::current_thread_cpus();
+  parlay::execute_with_scheduler(4, parlay::affinity_policy::nodes(), [&]() {
+    std::vector<std::atomic<bool>> checked(parlay::num_workers());
+    parlay::parallel_for(0, 100000, [&](size_t) {
+      size_t id = parlay::worker_id();
+      if (!checked[id].exchange(true)) {
+        auto mine = parlay::internal::current_thread_cpus();
+        ASSERT_TRUE(std::find(topology.node_cpus.begin(), topology.node_cpus.end(), mine) != topology.node_cpus.end());
+      }
+    });
+  });
+  ASSERT_EQ(parlay::internal::current_thread_cpus(), before);
+}
+
+#endif  // defined(__linux__)
+
 #endif  // defined(PARLAY_USING_PARLAY_SCHEDULER)
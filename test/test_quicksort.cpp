@@ -96,3 +96,42 @@ TEST(TestQuicksort, TestSortNonContiguous) {
   ASSERT_TRUE(std::is_sorted(std::begin(s), std::end(s)));
 }
 
+
+// Small sorts of arithmetic keys by std::less or std::greater go through the
+// sorting networks when they are enabled, so these cover every network size
+template <typename T, typename Compare, typename F>
+void check_small_sorts(Compare comp, F f) {
+  for (size_t n = 0; n <= 600; n += (n < 300 ? 1 : 37)) {
+    auto s = parlay::tabulate(n, [&](size_t i) -> T { return f(parlay::hash64(i + n)); });
+    auto s2 = s;
+    parlay::internal::quicksort(make_slice(s), comp);
+    std::sort(std::begin(s2), std::end(s2), comp);
+    ASSERT_EQ(s, s2);
+  }
+}
+
+TEST(TestQuicksort, TestSmallSortsInt) {
+  check_small_sorts<int>(std::less<>(), [](size_t x) { return static_cast<int>(x); });
+  check_small_sorts<int>(std::greater<int>(), [](size_t x) { return static_cast<int>(x % 7) - 3; });
+  check_small_sorts<unsigned int>(std::less<unsigned int>(), [](size_t x) { return static_cast<unsigned int>(x); });
+  check_small_sorts<unsigned int>(std::greater<>(), [](size_t x) { return static_cast<unsigned int>(x); });
+}
+
+TEST(TestQuicksort, TestSmallSortsLong) {
+  check_small_sorts<long long>(std::less<>(), [](size_t x) { return static_cast<long long>(x); });
+  check_small_sorts<long long>(std::greater<>(), [](size_t x) { return static_cast<long long>(x % 5) - 2; });
+  check_small_sorts<unsigned long long>(std::less<>(), [](size_t x) { return static_cast<unsigned long long>(x); });
+}
+
+TEST(TestQuicksort, TestSmallSortsFloatingPoint) {
+  check_small_sorts<float>(std::less<>(), [](size_t x) { return static_cast<float>(static_cast<long long>(x)) / 1000.0f; });
+  check_small_sorts<double>(std::less<double>(), [](size_t x) { return static_cast<double>(static_cast<long long>(x)) / 1000.0; });
+  check_small_sorts<double>(std::greater<>(), [](size_t x) { return static_cast<double>(static_cast<long long>(x % 9) - 4); });
+}
+
+TEST(TestQuicksort, TestSmallSortsPairs) {
+  check_small_sorts<std::pair<int, unsigned int>>(std::less<>(), [](size_t x) {
+    return std::make_pair(static_cast<int>(x % 11) - 5, static_cast<unsigned int>(x >> 32)); });
+  check_small_sorts<std::pair<unsigned int, int>>(std::greater<>(), [](size_t x) {
+    return std::make_pair(static_cast<unsigned int>(x % 3) * 0x7fffffffu, static_cast<int>(x >> 32)); });
+}
@@ -128,3 +128,61 @@ TEST(TestSampleSort, TestSortInplaceNonContiguous) {
   ASSERT_EQ(s, s2);
   ASSERT_TRUE(std::is_sorted(std::begin(s), std::end(s)));
 }
+
+TEST(TestSampleSort, TestBlockSampleSortInplace) {
+  for (size_t n : {size_t{0}, size_t{1}, size_t{1000}, size_t{16384}, size_t{100000}, size_t{1000000}}) {
+    auto s = parlay::tabulate(n, [](long long i) -> long long {
+      return (50021 * i + 61) % (1 << 20);
+    });
+    auto s2 = s;
+    parlay::internal::block_sample_sort_inplace(parlay::make_slice(s), std::less<long long>());
+    std::sort(std::begin(s2), std::end(s2));
+    ASSERT_EQ(s, s2);
+  }
+}
+
+TEST(TestSampleSort, TestBlockSampleSortInplaceCustomCompare) {
+  auto s = parlay::tabulate(1000000, [](long long i) -> long long {
+    return (50021 * i + 61) % (1 << 20);
+  });
+  auto s2 = s;
+  parlay::internal::block_sample_sort_inplace(parlay::make_slice(s), std::greater<long long>());
+  std::sort(std::rbegin(s2), std::rend(s2));
+  ASSERT_EQ(s, s2);
+  ASSERT_TRUE(std::is_sorted(std::rbegin(s), std::rend(s)));
+}
+
+TEST(TestSampleSort, TestBlockSampleSortInplaceDuplicates) {
+  // Few distinct keys, and one key that makes up most of the input,
+  // so that the splitters contain duplicates
+  for (long long distinct : {1LL, 7LL, 1000LL}) {
+    auto s = parlay::tabulate(1000000, [&](long long i) -> long long {
+      return (i % 4 == 0) ? (50021 * i + 61) % distinct : 3;
+    });
+    auto s2 = s;
+    parlay::internal::block_sample_sort_inplace(parlay::make_slice(s), std::less<long long>());
+    std::sort(std::begin(s2), std::end(s2));
+    ASSERT_EQ(s, s2);
+  }
+}
+
+TEST(TestSampleSort, TestBlockSampleSortInplaceStructs) {
+  auto s = parlay::tabulate(500000, [](int i) {
+    return std::make_pair((50021 * i + 61) % 1000, i);
+  });
+  auto s2 = s;
+  parlay::internal::block_sample_sort_inplace(parlay::make_slice(s), std::less<>());
+  std::sort(std::begin(s2), std::end(s2));
+  ASSERT_EQ(s, s2);
+}
+
+TEST(TestSampleSort, TestBlockSampleSortInplaceNonContiguous) {
+  auto ss = parlay::tabulate(300000, [](long long i) -> long long {
+    return (50021 * i + 61) % (1 << 20);
+  });
+  auto s = std::deque<long long>(ss.begin(), ss.end());
+  auto s2 = s;
+  parlay::internal::block_sample_sort_inplace(parlay::make_slice(s), std::less<long long>());
+  std::sort(std::begin(s2), std::end(s2));
+  ASSERT_EQ(s, s2);
+}
@@ -26,6 +26,14 @@ static_assert(sizeof(parlay::short_sequence<int>) <= 16);
 
 static_assert(alignof(parlay::sequence<int>) >= 8);
 
+// Small sequences grow by 8 bytes at a time and stay trivially relocatable
+#if defined(__GNUC__) && !defined(__MINGW64__)
+static_assert(sizeof(parlay::small_sequence<int, 3>) == 16);
+static_assert(sizeof(parlay::small_sequence<int, 4>) == 24);
+static_assert(sizeof(parlay::small_sequence<parlay::sequence<int>, 2>) == 40);
+#endif
+static_assert(parlay::is_trivially_relocatable_v<parlay::small_sequence<parlay::sequence<int>, 2>>);
+
 
 TEST(TestSequence, TestDefaultConstruct) {
   auto s = parlay::sequence<int>();
@@ -181,6 +189,63 @@ TEST(TestSequence, TestSmallNonTrivial) {
   ASSERT_EQ(*s[0], 5);
 }
 
+TEST(TestSequence, TestSmallSequenceInline) {
+  auto s = parlay::small_sequence<int, 8>();
+  int n = static_cast<int>(s.capacity());
+  ASSERT_GE(n, 8);
+  auto inline_data = s.data();
+  for (int i = 0; i < n; i++) s.push_back(i);
+  ASSERT_EQ(s.data(), inline_data);
+  s.push_back(n);
+  ASSERT_NE(s.data(), inline_data);
+  ASSERT_EQ(s.size(), n + 1);
+  for (int i = 0; i <= n; i++) ASSERT_EQ(s[i], i);
+  auto s2 = s;
+  s.clear();
+  ASSERT_TRUE(s.empty());
+  ASSERT_EQ(s2.size(), n + 1);
+  ASSERT_EQ(s2[n], n);
+}
+
+// Non-trivial but trivially relocatable elements are stored inline too
+TEST(TestSequence, TestSmallSequenceNonTrivial) {
+  using inner = parlay::sequence<int>;
+  auto s = parlay::small_sequence<inner, 2>();
+  auto inline_data = s.data();
+  s.push_back(inner{1, 2, 3});
+  s.push_back(inner(100, 5));
+  ASSERT_EQ(s.data(), inline_data);
+  auto copy = s;
+  ASSERT_EQ(copy, s);
+  auto moved = std::move(copy);
+  ASSERT_EQ(moved, s);
+  ASSERT_TRUE(copy.empty());
+  s.push_back(inner{4});
+  ASSERT_NE(s.data(), inline_data);
+  ASSERT_EQ(s[0], (inner{1, 2, 3}));
+  ASSERT_EQ(s[1], inner(100, 5));
+  ASSERT_EQ(s[2], inner{4});
+  s.pop_back();
+  moved.resize(1);
+  ASSERT_EQ(moved.size(), 1);
+  ASSERT_EQ(moved[0][2], 3);
+}
+
+TEST(TestSequence, TestSequenceOfSmallSequences) {
+  using adjacency = parlay::small_sequence<unsigned int, 6>;
+  size_t n = 100000;
+  auto graph = parlay::tabulate(n, [&](size_t i) {
+    return adjacency(i % 10, static_cast<unsigned int>(i));
+  });
+  for (size_t i = 0; i < n; i++) {
+    ASSERT_EQ(graph[i].size(), i % 10);
+    for (auto v : graph[i]) ASSERT_EQ(v, i);
+  }
+  auto graph2 = graph;
+  graph.clear();
+  ASSERT_EQ(graph2[12345].size(), 5);
+}
+
 TEST(TestSequence, TestLargeNonTrivial) {
   auto s = parlay::sequence<std::vector<int>>{
     std::vector<int>{1,2},
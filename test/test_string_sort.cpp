@@ -0,0 +1,117 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <parlay/primitives.h>
+#include <parlay/sequence.h>
+#include <parlay/utilities.h>
+
+// Checks that sorted is in order and that lcp is its LCP array
+template <typename Strings>
+void check_sorted_with_lcp(const Strings& sorted, const parlay::sequence<size_t>& lcp) {
+  ASSERT_EQ(sorted.size(), lcp.size());
+  for (size_t i = 1; i < sorted.size(); i++) {
+    std::string a(sorted[i - 1].begin(), sorted[i - 1].end());
+    std::string b(sorted[i].begin(), sorted[i].end());
+    ASSERT_LE(a, b);
+    size_t l = 0;
+    while (l < a.size() && l < b.size() && a[l] == b[l]) l++;
+    ASSERT_EQ(lcp[i], l);
+  }
+  if (!sorted.empty()) {
+    ASSERT_EQ(lcp[0], 0);
+  }
+}
+
+// Random strings over a small alphabet, with a shared prefix
+auto random_strings(size_t n, size_t max_len, const std::string& prefix = "") {
+  return parlay::tabulate(n, [&](size_t i) {
+    size_t len = parlay::hash64(i) % (max_len + 1);
+    std::string s = prefix;
+    for (size_t j = 0; j < len; j++) s += static_cast<char>('a' + parlay::hash64(i * 1000 + j) % 4);
+    return s;
+  });
+}
+
+TEST(TestStringSort, TestEmpty) {
+  auto s = parlay::sequence<std::string>();
+  auto [sorted, lcp] = parlay::string_sort(s);
+  ASSERT_TRUE(sorted.empty());
+  ASSERT_TRUE(lcp.empty());
+}
+
+TEST(TestStringSort, TestSmall) {
+  auto s = parlay::sequence<std::string>{"banana", "apple", "", "app", "apple", "b", "applesauce", ""};
+  auto [sorted, lcp] = parlay::string_sort(s);
+  auto expected = s;
+  std::sort(expected.begin(), expected.end());
+  ASSERT_EQ(sorted, expected);
+  ASSERT_EQ(lcp, (parlay::sequence<size_t>{0, 0, 0, 3, 5, 5, 0, 1}));
+}
+
+TEST(TestStringSort, TestRandom) {
+  for (size_t n : {size_t{100}, size_t{100000}}) {
+    auto s = random_strings(n, 12);
+    auto [sorted, lcp] = parlay::string_sort(s);
+    auto expected = s;
+    std::sort(expected.begin(), expected.end());
+    ASSERT_EQ(sorted, expected);
+    check_sorted_with_lcp(sorted, lcp);
+  }
+}
+
+TEST(TestStringSort, TestLongSharedPrefix) {
+  auto s = random_strings(100000, 8, "https://www.example.com/" + std::string(300, 'x') + "/");
+  auto [sorted, lcp] = parlay::string_sort(s);
+  auto expected = s;
+  std::sort(expected.begin(), expected.end());
+  ASSERT_EQ(sorted, expected);
+  check_sorted_with_lcp(sorted, lcp);
+}
+
+TEST(TestStringSort, TestAllEqual) {
+  auto s = parlay::sequence<std::string>(50000, std::string("same"));
+  auto [sorted, lcp] = parlay::string_sort(s);
+  ASSERT_EQ(sorted, s);
+  for (size_t i = 1; i < lcp.size(); i++) ASSERT_EQ(lcp[i], 4);
+}
+
+TEST(TestStringSort, TestUnsignedCharacters) {
+  // Characters above 127 sort after ASCII, as for std::string
+  auto s = parlay::tabulate(100000, [](size_t i) {
+    return parlay::tabulate(1 + i % 5, [i](size_t j) { return static_cast<char>(parlay::hash64(i + j) % 256); });
+  });
+  auto [sorted, lcp] = parlay::string_sort(s);
+  auto expected = parlay::map(s, [](const auto& x) { return std::string(x.begin(), x.end()); });
+  std::sort(expected.begin(), expected.end());
+  ASSERT_EQ(sorted.size(), expected.size());
+  for (size_t i = 0; i < sorted.size(); i++) {
+    ASSERT_EQ(std::string(sorted[i].begin(), sorted[i].end()), expected[i]);
+  }
+  check_sorted_with_lcp(sorted, lcp);
+}
+
+TEST(TestStringSort, TestSortIndex) {
+  auto s = random_strings(100000, 10, "log: ");
+  auto [permutation, lcp] = parlay::string_sort_index(s);
+  auto sorted = parlay::map(permutation, [&](size_t i) { return s[i]; });
+  auto expected = s;
+  std::sort(expected.begin(), expected.end());
+  ASSERT_EQ(sorted, expected);
+  check_sorted_with_lcp(sorted, lcp);
+}
+
+TEST(TestStringSort, TestSortInplace) {
+  auto s = random_strings(100000, 16);
+  auto expected = s;
+  std::sort(expected.begin(), expected.end());
+  auto lcp = parlay::string_sort_inplace(s);
+  ASSERT_EQ(s, expected);
+  check_sorted_with_lcp(s, lcp);
+
+  std::vector<std::string> v(expected.rbegin(), expected.rend());
+  parlay::string_sort_inplace(v);
+  ASSERT_TRUE(std::equal(v.begin(), v.end(), expected.begin(), expected.end()));
+}
@@ -0,0 +1,53 @@
+#include "gtest/gtest.h"
+
+#include <sstream>
+#include <string>
+
+#include <parlay/parallel.h>
+#include <parlay/primitives.h>
+#include <parlay/sequence.h>
+#include <parlay/trace.h>
+
+TEST(TestTrace, TestEmptyTrace) {
+  parlay::scheduler_trace trace;
+  trace.stop();
+  ASSERT_EQ(trace.num_events(), 0);
+  std::ostringstream ss;
+  trace.write_chrome_trace(ss);
+  ASSERT_NE(ss.str().find("traceEvents"), std::string::npos);
+}
+
+TEST(TestTrace, TestTraceParallelFor) {
+  parlay::scheduler_trace trace;
+  parlay::parallel_for(0, 10000, [](size_t) { }, 1);
+  trace.stop();
+  size_t recorded = trace.num_events();
+  // Nothing is recorded after the trace is stopped
+  parlay::parallel_for(0, 10000, [](size_t) { }, 1);
+  ASSERT_EQ(trace.num_events(), recorded);
+#if PARLAY_SCHEDULER_TRACE && defined(PARLAY_USING_PARLAY_SCHEDULER)
+  // Each of the 9999 forks runs its right branch as a job
+  ASSERT_GE(recorded, 2 * 9999);
+  std::ostringstream ss;
+  trace.write_chrome_trace(ss);
+  auto json = ss.str();
+  ASSERT_NE(json.find("\"ph\":\"B\""), std::string::npos);
+  ASSERT_NE(json.find("\"ph\":\"E\""), std::string::npos);
+#else
+  ASSERT_EQ(recorded, 0);
+#endif
+}
+
+TEST(TestTrace, TestRingBufferKeepsLatestEvents) {
+  parlay::scheduler_trace trace(64);
+  auto s = parlay::sort(parlay::tabulate(100000, [](size_t i) { return (i * 7919) % 100000; }));
+  trace.stop();
+  ASSERT_TRUE(parlay::is_sorted(s));
+#if PARLAY_SCHEDULER_TRACE && defined(PARLAY_USING_PARLAY_SCHEDULER)
+  ASSERT_LE(trace.num_events(), 64 * parlay::num_workers());
+  ASSERT_GT(trace.num_dropped_events(), 0);
+  std::ostringstream ss;
+  trace.write_chrome_trace(ss);
+  ASSERT_EQ(ss.str().back(), '\n');
+#endif
+}